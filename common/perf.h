@@ -0,0 +1,160 @@
+// 可选的硬件计数器（Linux perf_event_open），设置环境变量 PERF=1 时启用
+// lab1、lab2、lab4 共用这一份，各自以相对路径包含
+// 采集：核心周期数（随实际频率，区别于TSC）、指令数、L1D读缺失、末级缓存读缺失、分支预测失败、向量指令数
+// 向量指令没有通用事件：Intel 上默认用 FP_ARITH_INST_RETIRED 的所有打包浮点子事件（raw 0xfcc7），
+// 其他CPU需用 PERF_VEC=<十六进制raw编码> 指定，否则该列为 "-"
+// 权限不够（perf_event_paranoid）或内核/虚拟机不支持的事件在标准错误提示一次，对应列输出 "-"
+// 计数器对之后创建的线程继承（inherit），线程退出时计入；线程池中一直存活的线程（OpenMP）不会计入
+#ifndef PERF_H
+#define PERF_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <ostream>
+#ifdef __linux__
+#include <errno.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#define PERF_EVENTS 6
+static const char *perf_names[PERF_EVENTS] = {"core_cycles", "instructions", "l1d_miss", "llc_miss", "branch_miss", "vec_ops"};
+
+struct perf_sample
+{
+    double v[PERF_EVENTS];   // 计数值，复用计数器时已按运行时间比例放大
+    uint64_t raw[PERF_EVENTS][3]; // 开始时读到的 计数/启用时间/运行时间
+};
+
+static int perf_fd[PERF_EVENTS];
+
+inline bool perf_enabled()
+{
+    static int enabled = -1;
+    if (enabled < 0)
+        enabled = getenv("PERF") && strcmp(getenv("PERF"), "0");
+    return enabled;
+}
+
+#ifdef __linux__
+inline int perf_open(uint32_t type, uint64_t config)
+{
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1; // paranoid=2 时普通用户只能计用户态
+    attr.exclude_hv = 1;
+    return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+inline bool intel_cpu()
+{
+    FILE *f = fopen("/proc/cpuinfo", "r");
+    char line[256];
+    bool intel = false;
+    while (f && fgets(line, sizeof(line), f))
+        if (!strncmp(line, "vendor_id", 9))
+        {
+            intel = strstr(line, "GenuineIntel") != NULL;
+            break;
+        }
+    if (f)
+        fclose(f);
+    return intel;
+}
+#endif
+
+// 第一次调用时打开所有事件，打不开的记为 -1
+inline void perf_init()
+{
+    static bool ready = false;
+    if (ready)
+        return;
+    ready = true;
+    for (int e = 0; e < PERF_EVENTS; e++)
+        perf_fd[e] = -1;
+#ifdef __linux__
+    const uint64_t read_miss = PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16;
+    uint32_t type[PERF_EVENTS] = {PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE,
+                                  PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE, PERF_TYPE_RAW};
+    uint64_t config[PERF_EVENTS] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                    PERF_COUNT_HW_CACHE_L1D | read_miss, PERF_COUNT_HW_CACHE_LL | read_miss,
+                                    PERF_COUNT_HW_BRANCH_MISSES, 0};
+    const char *vec = getenv("PERF_VEC");
+    bool have_vec = vec || intel_cpu();
+    config[5] = vec ? strtoull(vec, NULL, 16) : 0xfcc7;
+    for (int e = 0; e < PERF_EVENTS; e++)
+    {
+        if (e == 5 && !have_vec)
+            continue;
+        perf_fd[e] = perf_open(type[e], config[e]);
+        if (perf_fd[e] < 0)
+            fprintf(stderr, "perf: %s unavailable (%s)\n", perf_names[e], strerror(errno));
+    }
+#else
+    fprintf(stderr, "perf: hardware counters are only supported on Linux\n");
+#endif
+}
+
+inline void perf_read(int e, uint64_t out[3])
+{
+    out[0] = out[1] = out[2] = 0;
+#ifdef __linux__
+    if (perf_fd[e] >= 0 && read(perf_fd[e], out, sizeof(uint64_t) * 3) != sizeof(uint64_t) * 3)
+        out[0] = out[1] = out[2] = 0;
+#endif
+}
+
+inline void perf_start(perf_sample &s)
+{
+    if (!perf_enabled())
+        return;
+    perf_init();
+    for (int e = 0; e < PERF_EVENTS; e++)
+        perf_read(e, s.raw[e]);
+}
+
+inline void perf_stop(perf_sample &s)
+{
+    if (!perf_enabled())
+        return;
+    for (int e = 0; e < PERF_EVENTS; e++)
+    {
+        uint64_t now[3];
+        perf_read(e, now);
+        double count = now[0] - s.raw[e][0];
+        double enabled = now[1] - s.raw[e][1], running = now[2] - s.raw[e][2];
+        s.v[e] = perf_fd[e] < 0 ? -1 : running > 0 ? count * enabled / running : count;
+    }
+}
+
+// 按 "值," 输出各计数器除以 div（如重复次数）后的结果，不可用的输出 "-,"；未启用时什么也不输出
+inline void perf_csv(std::ostream &out, const perf_sample &s, double div = 1)
+{
+    if (!perf_enabled())
+        return;
+    for (int e = 0; e < PERF_EVENTS; e++)
+        if (s.v[e] < 0)
+            out << "-,";
+        else
+            out << (uint64_t)(s.v[e] / div) << ',';
+}
+
+// 按 "名称_事件:值" 逐行输出，供每行一个指标的程序使用；不可用的事件不输出
+inline void perf_lines(std::ostream &out, const char *name, const perf_sample &s, double div = 1)
+{
+    if (!perf_enabled())
+        return;
+    for (int e = 0; e < PERF_EVENTS; e++)
+        if (s.v[e] >= 0)
+            out << name << '_' << perf_names[e] << ':' << (uint64_t)(s.v[e] / div) << std::endl;
+}
+
+#endif
@@ -1,25 +1,27 @@
 import matplotlib.pyplot as plt
 
+# 每行为 "内核名:值"，内核名后缀 _cycles 为每次乘加的周期数，_bpc 为每周期读入的字节数，
+# _core_cycles/_instructions/_*_miss/_vec_ops 为 PERF=1 时的硬件计数器（此处不画）
 N_values = []
-ordinary_times = []
-optimize_times = []
-unroll_times = []
+times = {}
+bytes_per_cycle = {}
 
 with open('1.txt', 'r') as file:
     for line in file:
         if line.startswith('Testing with N = '):
             N_values.append(int(line.strip().split('= ')[1]))
-        elif 'ordinary:' in line:
-            ordinary_times.append(float(line.strip().split(':')[1].replace('ms', '')))
-        elif 'optimize:' in line:
-            optimize_times.append(float(line.strip().split(':')[1].replace('ms', '')))
-        elif 'unroll:' in line:
-            unroll_times.append(float(line.strip().split(':')[1].replace('ms', '')))
+            continue
+        name, value = line.strip().split(':')
+        if name.endswith(('_cycles', '_instructions', '_miss', '_vec_ops')):
+            continue
+        elif name.endswith('_bpc'):
+            bytes_per_cycle.setdefault(name[:-len('_bpc')], []).append(float(value))
+        else:
+            times.setdefault(name, []).append(float(value.replace('ms', '')))
 
 plt.figure(figsize=(10, 6))
-plt.plot(N_values, ordinary_times, color='blue', linestyle='-', linewidth=2, markersize=5, label='Ordinary')
-plt.plot(N_values, optimize_times, color='red', linestyle='-', linewidth=2, markersize=5, label='Optimize')
-plt.plot(N_values, unroll_times, color='green', linestyle='-', linewidth=2, markersize=5, label='Unroll')
+for name, values in times.items():
+    plt.plot(N_values, values, linestyle='-', linewidth=2, markersize=5, label=name.replace('_', ' ').title())
 
 plt.title('Performance Comparison')
 plt.xlabel('N Value')
@@ -28,3 +30,18 @@ plt.ylabel('Execution Time (ms)')
 plt.legend()
 plt.grid(True)
 plt.show()
+
+# 缓存层级的变化在吞吐上更明显
+if bytes_per_cycle:
+    plt.figure(figsize=(10, 6))
+    for name, values in bytes_per_cycle.items():
+        plt.plot(N_values, values, linestyle='-', linewidth=2, markersize=5, label=name.replace('_', ' ').title())
+
+    plt.title('Throughput Comparison')
+    plt.xlabel('N Value')
+    plt.ylabel('Bytes per Cycle')
+    plt.xscale('log', base=2)
+
+    plt.legend()
+    plt.grid(True)
+    plt.show()
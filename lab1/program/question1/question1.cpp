@@ -1,16 +1,37 @@
 #include <iostream>
 #include<fstream>
-#include <windows.h>
+#include <stdlib.h>
+#include "../timer.h"
 using namespace std;
 
+// 连续存储时每行补齐到整缓存行后再多留 PAD 个元素，
+// 避免N为2的幂时同一列的元素全部映射到同一个缓存组
+#define LINE 64
+#ifndef PAD
+#define PAD 16
+#endif
+
 int **b;
+int *bc;    // 连续存储的矩阵，首地址按缓存行对齐，第j行从 bc + j * ld 开始
+int ld;     // 行跨度（元素数）
 int *a, *sum;
+int *expect;   // ordinary 的结果，其他版本与它比较
 int LOOP = 10;
 fstream f;
 
+// 输出每次的平均时间，以及内层每次乘加的周期数
+void report(const char *name, const Timer &t, int N) {
+    f << name << ":" << t.ms() / LOOP << "ms" << endl;
+    f << name << "_cycles:" << (double)t.cycles / LOOP / N / N << endl;
+    // 每周期读入的矩阵字节数，N 增大越过各级缓存时会出现台阶
+    f << name << "_bpc:" << (double)N * N * sizeof(int) * LOOP / t.cycles << endl;
+    perf_lines(f, name, t.perf, LOOP);
+}
+
 void init(int N) {
     a = new int[N];
     sum = new int[N];
+    expect = new int[N];
     b = new int*[N];
     for(int i = 0; i < N; i++) {
         a[i] = i;
@@ -20,21 +41,36 @@ void init(int N) {
             b[i][j] = i + j;
         }
     }
+    ld = (N * sizeof(int) + LINE - 1) / LINE * LINE / sizeof(int) + PAD;
+    size_t bytes = (size_t)N * ld * sizeof(int);
+#ifdef _WIN32
+    bc = (int *)_aligned_malloc(bytes, LINE);
+#else
+    bc = (int *)aligned_alloc(LINE, bytes);
+#endif
+    for(int i = 0; i < N; i++)
+        for(int j = 0; j < N; j++)
+            bc[i * ld + j] = i + j;
 }
 
 void cleanUp(int N) {
     delete[] a;
     delete[] sum;
+    delete[] expect;
     for(int i = 0; i < N; i++) {
         delete[] b[i];
     }
     delete[] b;
+#ifdef _WIN32
+    _aligned_free(bc);
+#else
+    free(bc);
+#endif
 }
 
 void ordinary(int N) {
-    long long int begin, end, freq;
-    QueryPerformanceFrequency((LARGE_INTEGER *) &freq);
-    QueryPerformanceCounter((LARGE_INTEGER*) &begin);
+    Timer t;
+    t.start();
     for(int l = 0; l < LOOP; l++) {
         for(int i = 0; i < N; i++) {
             sum[i] = 0;
@@ -43,14 +79,13 @@ void ordinary(int N) {
             }
         }
     }
-    QueryPerformanceCounter((LARGE_INTEGER*) &end);
-    f << "ordinary:" << (end - begin) * 1000.0 / freq / LOOP << "ms" << endl;
+    t.stop();
+    report("ordinary", t, N);
 }
 
 void optimize(int N) {
-    long long int begin, end, freq;
-    QueryPerformanceFrequency((LARGE_INTEGER *)&freq);
-    QueryPerformanceCounter((LARGE_INTEGER*)&begin);
+    Timer t;
+    t.start();
     for(int l=0;l<LOOP;l++)
     {
         for(int i=0;i<N;i++)
@@ -59,60 +94,195 @@ void optimize(int N) {
             for(int i=0;i<N;i++)
                 sum[i]+=a[j]*b[j][i];
     }
-    QueryPerformanceCounter((LARGE_INTEGER*)&end);
-    f << "optimize:" << (end - begin) *1000.0 / freq / LOOP << "ms" << endl;
+    t.stop();
+    report("optimize", t, N);
+}
+
+// 与 ordinary 相同的列访问，矩阵为连续存储
+void ordinary_flat(int N) {
+    Timer t;
+    t.start();
+    for(int l = 0; l < LOOP; l++) {
+        for(int i = 0; i < N; i++) {
+            sum[i] = 0;
+            for(int j = 0; j < N; j++) {
+                sum[i] += a[j] * bc[j * ld + i];
+            }
+        }
+    }
+    t.stop();
+    report("ordinary_flat", t, N);
+}
+
+// 与 optimize 相同的行访问，矩阵为连续存储
+void optimize_flat(int N) {
+    Timer t;
+    t.start();
+    for(int l=0;l<LOOP;l++)
+    {
+        for(int i=0;i<N;i++)
+            sum[i]=0;
+        for(int j=0;j<N;j++)
+        {
+            const int *row = bc + j * ld;
+            for(int i=0;i<N;i++)
+                sum[i]+=a[j]*row[i];
+        }
+    }
+    t.stop();
+    report("optimize_flat", t, N);
 }
 
+// 一次处理16行：每个 i 先把16行的乘积分别算进16个临时变量，再一起加到 sum[i]
 void unroll(int N) {
-    long long int begin, end, freq;
-    QueryPerformanceFrequency((LARGE_INTEGER *)&freq);
-    QueryPerformanceCounter((LARGE_INTEGER*)&begin);
+    Timer t;
+    t.start();
     for(int l = 0; l < LOOP; l++) {
-        for(int i = 0; i < N; i++) 
-        sum[i] = 0;
-        for(int j = 0; j < N; j+=16) {
-        int tmp0=0,tmp1=0,tmp2=0,tmp3=0,tmp4=0,tmp5=0,tmp6=0,tmp7=0,tmp8=0,tmp9=0,tmp10=0,tmp11=0,tmp12=0,tmp13=0,tmp14=0,tmp15=0;
+        for(int i = 0; i < N; i++)
+            sum[i] = 0;
+        int j = 0;
+        for(; j + 16 <= N; j+=16) {
         for(int i=0;i<N;i++)
         {
-            tmp0+=a[j+0]*b[j+0][i];
-            tmp1+=a[j+1]*b[j+1][i];
-            tmp2+=a[j+2]*b[j+2][i];
-            tmp3+=a[j+3]*b[j+3][i];
-            tmp4+=a[j+4]*b[j+4][i];
-            tmp5+=a[j+5]*b[j+5][i];
-            tmp6+=a[j+6]*b[j+6][i];
-            tmp6+=a[j+6]*b[j+6][i];
-            tmp7+=a[j+7]*b[j+7][i];
-            tmp8+=a[j+8]*b[j+8][i];
-            tmp9+=a[j+9]*b[j+9][i];
-            tmp10+=a[j+10]*b[j+10][i];
-            tmp11+=a[j+11]*b[j+11][i];
-            tmp12+=a[j+12]*b[j+12][i];
-            tmp13+=a[j+13]*b[j+13][i];
-            tmp14+=a[j+14]*b[j+14][i];
-            tmp15+=a[j+15]*b[j+15][i];
+            int tmp0=a[j+0]*b[j+0][i];
+            int tmp1=a[j+1]*b[j+1][i];
+            int tmp2=a[j+2]*b[j+2][i];
+            int tmp3=a[j+3]*b[j+3][i];
+            int tmp4=a[j+4]*b[j+4][i];
+            int tmp5=a[j+5]*b[j+5][i];
+            int tmp6=a[j+6]*b[j+6][i];
+            int tmp7=a[j+7]*b[j+7][i];
+            int tmp8=a[j+8]*b[j+8][i];
+            int tmp9=a[j+9]*b[j+9][i];
+            int tmp10=a[j+10]*b[j+10][i];
+            int tmp11=a[j+11]*b[j+11][i];
+            int tmp12=a[j+12]*b[j+12][i];
+            int tmp13=a[j+13]*b[j+13][i];
+            int tmp14=a[j+14]*b[j+14][i];
+            int tmp15=a[j+15]*b[j+15][i];
+            sum[i]+=((tmp0+tmp1)+(tmp2+tmp3))+((tmp4+tmp5)+(tmp6+tmp7))
+                   +((tmp8+tmp9)+(tmp10+tmp11))+((tmp12+tmp13)+(tmp14+tmp15));
+        }
+        }
+        for(; j < N; j++)
+            for(int i = 0; i < N; i++)
+                sum[i] += a[j] * b[j][i];
+    }
+    t.stop();
+    report("unroll", t, N);
+}
+
+// 以下向量化版本使用连续存储的 bc，按行访问：广播 a[j]，与第j行逐向量相乘后加到 sum
+// 用 target 属性单独编译，运行时按 CPU 支持情况选择，不需要 -mavx2 等编译选项
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define HAVE_X86_SIMD
+
+__attribute__((target("avx2"))) void avx2(int N) {
+    Timer t;
+    t.start();
+    for(int l = 0; l < LOOP; l++) {
+        for(int i = 0; i < N; i++)
+            sum[i] = 0;
+        for(int j = 0; j < N; j++) {
+            const int *row = bc + j * ld;
+            __m256i aj = _mm256_set1_epi32(a[j]);
+            int i = 0;
+            for(; i + 16 <= N; i += 16) { // 展开两个向量，两条乘法链互不依赖
+                __m256i s0 = _mm256_loadu_si256((__m256i *)(sum + i));
+                __m256i s1 = _mm256_loadu_si256((__m256i *)(sum + i + 8));
+                s0 = _mm256_add_epi32(s0, _mm256_mullo_epi32(aj, _mm256_load_si256((const __m256i *)(row + i))));
+                s1 = _mm256_add_epi32(s1, _mm256_mullo_epi32(aj, _mm256_load_si256((const __m256i *)(row + i + 8))));
+                _mm256_storeu_si256((__m256i *)(sum + i), s0);
+                _mm256_storeu_si256((__m256i *)(sum + i + 8), s1);
+            }
+            for(; i < N; i++)
+                sum[i] += a[j] * row[i];
+        }
+    }
+    t.stop();
+    report("avx2", t, N);
+}
+
+__attribute__((target("avx512f"))) void avx512(int N) {
+    Timer t;
+    t.start();
+    for(int l = 0; l < LOOP; l++) {
+        for(int i = 0; i < N; i++)
+            sum[i] = 0;
+        for(int j = 0; j < N; j++) {
+            const int *row = bc + j * ld;
+            __m512i aj = _mm512_set1_epi32(a[j]);
+            int i = 0;
+            for(; i + 16 <= N; i += 16) {
+                __m512i s = _mm512_loadu_si512(sum + i);
+                s = _mm512_add_epi32(s, _mm512_mullo_epi32(aj, _mm512_load_si512(row + i)));
+                _mm512_storeu_si512(sum + i, s);
+            }
+            if(i < N) { // 不足16个的尾部用掩码处理
+                __mmask16 m = (__mmask16)((1u << (N - i)) - 1);
+                __m512i s = _mm512_maskz_loadu_epi32(m, sum + i);
+                s = _mm512_add_epi32(s, _mm512_mullo_epi32(aj, _mm512_maskz_loadu_epi32(m, row + i)));
+                _mm512_mask_storeu_epi32(sum + i, m, s);
+            }
+        }
+    }
+    t.stop();
+    report("avx512", t, N);
+}
+#endif
+
+// 按列分块：每块 BLOCK 个 sum 留在L1中，把所有行的这一段扫一遍再处理下一块
+#ifndef BLOCK
+#define BLOCK 1024
+#endif
+void blocked(int N) {
+    Timer t;
+    t.start();
+    for(int l = 0; l < LOOP; l++) {
+        for(int i = 0; i < N; i++)
+            sum[i] = 0;
+        for(int ii = 0; ii < N; ii += BLOCK) {
+            int iend = ii + BLOCK < N ? ii + BLOCK : N;
+            for(int j = 0; j < N; j++) {
+                const int *row = bc + j * ld;
+                for(int i = ii; i < iend; i++)
+                    sum[i] += a[j] * row[i];
+            }
         }
-        sum[j+0]=tmp0;
-        sum[j+1]=tmp1;
-        sum[j+2]=tmp2;
-        sum[j+3]=tmp3;
-        sum[j+4]=tmp4;
-        sum[j+5]=tmp5;
-        sum[j+6]=tmp6;
-        sum[j+7]=tmp7;
-        sum[j+8]=tmp8;
-        sum[j+9]=tmp9;
-        sum[j+10]=tmp10;
-        sum[j+11]=tmp11;
-        sum[j+12]=tmp12;
-        sum[j+13]=tmp13;
-        sum[j+14]=tmp14;
-        sum[j+15]=tmp15;
+    }
+    t.stop();
+    report("blocked", t, N);
+}
+
+// 各线程负责 sum 中不相交的一段列，互不写同一缓存行；用 -fopenmp 编译，线程数由 OMP_NUM_THREADS 决定
+void omp(int N) {
+    Timer t;
+    t.start();
+    for(int l = 0; l < LOOP; l++) {
+        #pragma omp parallel for schedule(static)
+        for(int ii = 0; ii < N; ii += LINE / sizeof(int)) {
+            int iend = ii + (int)(LINE / sizeof(int)) < N ? ii + (int)(LINE / sizeof(int)) : N;
+            for(int i = ii; i < iend; i++)
+                sum[i] = 0;
+            for(int j = 0; j < N; j++) {
+                const int *row = bc + j * ld;
+                for(int i = ii; i < iend; i++)
+                    sum[i] += a[j] * row[i];
+            }
         }
-        
     }
-    QueryPerformanceCounter((LARGE_INTEGER*)&end);
-    f << "unroll:" << (end - begin) * 1000.0 / freq / LOOP << "ms" << endl;
+    t.stop();
+    report("omp", t, N);
+}
+
+// 与 ordinary 的结果比较，不一致时输出到标准错误
+void check(const char *name, int N) {
+    for(int i = 0; i < N; i++)
+        if(sum[i] != expect[i]) {
+            cerr << name << ": mismatch at N = " << N << ", i = " << i << endl;
+            return;
+        }
 }
 
 void testSizes(int start, int end, int step) {
@@ -120,12 +290,36 @@ void testSizes(int start, int end, int step) {
         f << "Testing with N = " << N << endl;
         init(N);
         ordinary(N);
+        for(int i = 0; i < N; i++)
+            expect[i] = sum[i];
         optimize(N);
+        check("optimize", N);
+        ordinary_flat(N);
+        check("ordinary_flat", N);
+        optimize_flat(N);
+        check("optimize_flat", N);
         unroll(N);
+        check("unroll", N);
+#ifdef HAVE_X86_SIMD
+        if(__builtin_cpu_supports("avx2")) {
+            avx2(N);
+            check("avx2", N);
+        }
+        if(__builtin_cpu_supports("avx512f")) {
+            avx512(N);
+            check("avx512", N);
+        }
+#endif
+        blocked(N);
+        check("blocked", N);
+        omp(N);
+        check("omp", N);
         cleanUp(N);
     }
 }
 
+// 编译运行（Linux/Windows）：g++ -O2 question1.cpp -o question1 && ./question1
+//                      多线程版本加 -fopenmp
 int main() {
     f.open("txt.txt",ios::out);
     int start = 16;
@@ -1,58 +1,175 @@
 #include <iostream>
-#include <windows.h>
+#include "../timer.h"
 using namespace std;
 
 #define ull unsigned long long int
 
+#ifndef MAX_N
+#define MAX_N (1ull << 26) // 最大规模 512MB，远超末级缓存，可以看到内存带宽的平台
+#endif
+#define TREE_BASE 32 // 树形归约的叶子规模
+
 ull *a;
 int LOOP = 10;
+volatile ull sink; // 每次的结果都写入这里，防止编译器把求和当作死代码删掉
+
+// 输出每次的平均时间，以及每个元素的周期数和每周期读入的字节数
+void report(const char *name, const Timer &t, ull N)
+{
+    cout << name << ":" << t.ms() / LOOP << "ms" << endl;
+    cout << name << "_cycles:" << (double)t.cycles / LOOP / N << endl;
+    cout << name << "_bpc:" << (double)N * sizeof(ull) * LOOP / t.cycles << endl;
+    perf_lines(cout, name, t.perf, LOOP);
+}
 
 void init(ull N)
 {
     a = new ull[N];
-    for (ull i = 0; i < N; i++)
+    #pragma omp parallel for schedule(static)
+    for (long long i = 0; i < (long long)N; i++)
         a[i] = i;
 }
 
-void ordinary(ull N)
+// 计时 LOOP 次，并检查结果是否等于 0+1+...+(N-1)
+template <typename F>
+void measure(const char *name, F kernel, ull N)
 {
-    long long int begin, end, freq;
-    QueryPerformanceFrequency((LARGE_INTEGER *) &freq);
-    QueryPerformanceCounter((LARGE_INTEGER*) &begin);
+    ull sum = 0;
+    Timer t;
+    t.start();
     for(int l=0;l<LOOP;l++)
+    {
+        sum = kernel(N);
+        sink = sum;
+    }
+    t.stop();
+    if (sum != N * (N - 1) / 2)
+        cerr << name << ": wrong sum at N = " << N << endl;
+    report(name, t, N);
+}
+
+ull ordinary(ull N)
+{
+    ull sum = 0;
+    for (ull i = 0; i < N; i++)
+        sum += a[i];
+    return sum;
+}
+
+ull optimize(ull N)
+{
+    ull sum1 = 0, sum2 = 0;
+    ull i = 0;
+    for(;i+1<N; i+=2)
+        sum1+=a[i],sum2+= a[i+1];
+    if (i < N)
+        sum1 += a[i];
+    return sum1 + sum2;
+}
+
+// K 路累加器：K 条互不依赖的加法链，K 足够大时可以掩盖加法延迟
+template <int K>
+ull accumulate(ull N)
+{
+    ull s[K] = {0};
+    ull i = 0;
+    for (; i + K <= N; i += K)
+        for (int k = 0; k < K; k++)
+            s[k] += a[i + k];
+    for (; i < N; i++)
+        s[0] += a[i];
+    ull sum = 0;
+    for (int k = 0; k < K; k++)
+        sum += s[k];
+    return sum;
+}
+
+// 递归两两归约，叶子规模 TREE_BASE
+ull pairwise(const ull *p, ull n)
+{
+    if (n <= TREE_BASE)
     {
         ull sum = 0;
-        for (ull i = 0; i < N; i++)
-            sum += a[i];
+        for (ull i = 0; i < n; i++)
+            sum += p[i];
+        return sum;
     }
-    QueryPerformanceCounter((LARGE_INTEGER*) &end);
-    cout<<"ordinary:"<<(end-begin)*1000.0/freq/LOOP<<"ms"<<endl;
+    return pairwise(p, n / 2) + pairwise(p + n / 2, n - n / 2);
 }
 
-void optimize(ull N)
+ull tree(ull N)
 {
-    long long int begin, end, freq;
-    QueryPerformanceFrequency((LARGE_INTEGER *) &freq);
-    QueryPerformanceCounter((LARGE_INTEGER*) &begin);
-    for(int l=0;l<LOOP;l++)
+    return pairwise(a, N);
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define HAVE_X86_SIMD
+// 每个 AVX2 向量 4 个 64 位通道，4 个向量累加器共 16 路
+__attribute__((target("avx2"))) ull avx2(ull N)
+{
+    __m256i s0 = _mm256_setzero_si256(), s1 = s0, s2 = s0, s3 = s0;
+    ull i = 0;
+    for (; i + 16 <= N; i += 16)
     {
-        ull sum1 = 0, sum2 = 0;
-        for(ull i=0;i<N-1; i+=2)
-            sum1+=a[i],sum2+= a[i+1];
-        ull sum = sum1 + sum2;
+        s0 = _mm256_add_epi64(s0, _mm256_loadu_si256((const __m256i *)(a + i)));
+        s1 = _mm256_add_epi64(s1, _mm256_loadu_si256((const __m256i *)(a + i + 4)));
+        s2 = _mm256_add_epi64(s2, _mm256_loadu_si256((const __m256i *)(a + i + 8)));
+        s3 = _mm256_add_epi64(s3, _mm256_loadu_si256((const __m256i *)(a + i + 12)));
     }
-    QueryPerformanceCounter((LARGE_INTEGER*) &end);
-    cout<<"optimize:"<<(end-begin)*1000.0/freq/LOOP<<"ms"<<endl;
+    __m256i s = _mm256_add_epi64(_mm256_add_epi64(s0, s1), _mm256_add_epi64(s2, s3));
+    __m128i h = _mm_add_epi64(_mm256_castsi256_si128(s), _mm256_extracti128_si256(s, 1));
+    ull sum = _mm_cvtsi128_si64(h) + _mm_extract_epi64(h, 1);
+    for (; i < N; i++)
+        sum += a[i];
+    return sum;
+}
+#endif
+
+// 多线程归约，用 -fopenmp 编译，线程数由 OMP_NUM_THREADS 决定
+ull threads(ull N)
+{
+    ull sum = 0;
+    #pragma omp parallel for schedule(static) reduction(+ : sum)
+    for (long long i = 0; i < (long long)N; i++)
+        sum += a[i];
+    return sum;
+}
+
+// 依次测试 K = 1..16 路累加器
+template <int K>
+void measure_accumulate(ull N)
+{
+    if constexpr (K > 1)
+        measure_accumulate<K - 1>(N);
+    string name = "acc" + to_string(K);
+    measure(name.c_str(), accumulate<K>, N);
 }
 
+// 编译运行（Linux/Windows）：g++ -O2 -std=c++17 problem2.cpp -o problem2 && ./problem2
+//                      多线程版本加 -fopenmp
 int main()
 {
-    ull start = 16, end = 4096, step = 16;
-    for(ull N = start; N <= end; N += step)
+    // 规模按 2^(1/4) 倍递增；小规模多重复几次，使每个规模的总读入量相近
+    ull last = 0;
+    for (double x = 16; x <= MAX_N; x *= 1.189207115)
     {
+        ull N = (ull)x / 4 * 4;
+        if (N == last) // 小规模时相邻两个 x 取整后可能相同
+            continue;
+        last = N;
+        LOOP = max(10ull, (1ull << 24) / N);
+        cout << "Testing with N = " << N << endl;
         init(N);
-        ordinary(N);
-        optimize(N);
+        measure("ordinary", ordinary, N);
+        measure("optimize", optimize, N);
+        measure_accumulate<16>(N);
+        measure("tree", tree, N);
+#ifdef HAVE_X86_SIMD
+        if (__builtin_cpu_supports("avx2"))
+            measure("avx2", avx2, N);
+#endif
+        measure("threads", threads, N);
         delete[] a;
     }
 }
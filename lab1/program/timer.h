@@ -0,0 +1,67 @@
+// 跨平台计时，question1 和 question2 共用
+// Windows 用 QueryPerformanceCounter，其他平台用 clock_gettime(CLOCK_MONOTONIC_RAW)（不受NTP调频影响）
+// 周期数：x86 读 rdtscp 时间戳计数器（按标称频率计数，不随睿频变化），
+//         其他平台没有用户态可读的周期计数器，按 CPU_GHZ 由时间换算
+#ifndef TIMER_H
+#define TIMER_H
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#define HAVE_TSC
+#endif
+
+#include "../../common/perf.h" // PERF=1 时 Timer 同时读取硬件计数器
+
+#ifndef CPU_GHZ
+#define CPU_GHZ 1.0 // 无TSC时用于把纳秒换算成周期，按实际主频设置
+#endif
+
+inline double now_ns() {
+#ifdef _WIN32
+    long long int count, freq;
+    QueryPerformanceFrequency((LARGE_INTEGER *)&freq);
+    QueryPerformanceCounter((LARGE_INTEGER *)&count);
+    return count * 1e9 / freq;
+#else
+    timespec t;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &t);
+    return t.tv_sec * 1e9 + t.tv_nsec;
+#endif
+}
+
+inline unsigned long long now_cycles() {
+#ifdef HAVE_TSC
+    unsigned int aux;
+    return __rdtscp(&aux); // rdtscp 等之前的指令执行完才读，不会被提前
+#else
+    return (unsigned long long)(now_ns() * CPU_GHZ);
+#endif
+}
+
+struct Timer {
+    double begin_ns, ns;
+    unsigned long long begin_cycles, cycles;
+    perf_sample perf;
+    void start() {
+        perf_start(perf);
+        begin_ns = now_ns();
+        begin_cycles = now_cycles();
+    }
+    void stop() {
+        cycles = now_cycles() - begin_cycles;
+        ns = now_ns() - begin_ns;
+        perf_stop(perf);
+    }
+    double ms() const { return ns / 1e6; }
+};
+
+#endif
@@ -0,0 +1,44 @@
+import csv
+import json
+import sys
+from collections import defaultdict
+
+import matplotlib.pyplot as plt
+
+# 读取 lab4 中 BENCH_OUT 输出的 CSV 或 JSON Lines，画出各内核的时间与吞吐随规模的变化
+# 用法：python bench.py result.csv
+path = sys.argv[1] if len(sys.argv) > 1 else 'result.csv'
+if path.endswith('.json') or path.endswith('.jsonl'):
+    records = [json.loads(line) for line in open(path) if line.strip()]
+else:
+    records = list(csv.DictReader(open(path)))
+
+# 按 (程序, 内核, 线程数) 分组
+series = defaultdict(list)
+unit = {}
+for r in records:
+    key = (r['program'], r['kernel'], int(r['threads']))
+    series[key].append((int(r['n']), float(r['median']) * 1000, float(r['stddev']) * 1000, float(r['rate'])))
+    unit[r['program']] = r['unit']
+
+for program in sorted(unit):
+    fig, (ax_t, ax_r) = plt.subplots(1, 2, figsize=(14, 6))
+    for (prog, kernel, threads), points in sorted(series.items()):
+        if prog != program:
+            continue
+        points.sort()
+        n = [p[0] for p in points]
+        label = '%s (%d threads)' % (kernel, threads)
+        # 误差线为重复运行的标准差
+        ax_t.errorbar(n, [p[1] for p in points], yerr=[p[2] for p in points], marker='o', capsize=3, label=label)
+        ax_r.plot(n, [p[3] for p in points], marker='o', label=label)
+    ax_t.set_xlabel('Problem Size')
+    ax_t.set_ylabel('Median Time (ms)')
+    ax_t.set_title(program + ': Time')
+    ax_r.set_xlabel('Problem Size')
+    ax_r.set_ylabel(unit[program])
+    ax_r.set_title(program + ': Throughput')
+    for ax in (ax_t, ax_r):
+        ax.legend()
+        ax.grid(True)
+plt.show()
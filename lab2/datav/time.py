@@ -1,49 +1,65 @@
-import matplotlib.pyplot as plt
-"""
-# 问题规模
-problem_sizes = [200, 500, 1000, 2000, 3000, 4000, 5000, 6000]
-
-# 串行时间/ms
-serial_times = [19.284, 301.546, 2434.87, 19620.7, 65878.5, 158788, 259545.3, 448727.686]
+import csv
+import sys
+from collections import defaultdict
 
-# 并行时间/ms
-parallel_times = [12.712, 197.319, 1592.47, 12837.6, 42919.8, 103591, 169738.75, 292886.5]
+import matplotlib.pyplot as plt
 
-# 加速比
-speedups = []
-for i in range(len(problem_sizes)):
-    speedups.append(serial_times[i]/parallel_times[i])
-"""
-# 问题规模
-problem_sizes = [8399, 23045, 37960]
+# 读取 lab4 中 SCALE_THREADS 扫描输出的 tidy CSV（gauss_timing.sh / groebner_timing.sh 生成），
+# 每个 (程序, 内核) 画出时间、加速比、强/弱扩展效率和 Karp-Flatt 实验串行比例
+# 用法：python time.py gauss_scaling.csv
+path = sys.argv[1] if len(sys.argv) > 1 else 'scaling.csv'
+rows = list(csv.DictReader(open(path)))
 
-# 串行时间/ms
-serial_times = [97.412, 227.282, 475.283]
+# (程序, 内核, 模式, 基准规模) -> [(线程数, 规模, 时间ms, 加速比, 效率, Karp-Flatt)]
+series = defaultdict(list)
+for r in rows:
+    key = (r['program'], r['kernel'], r['mode'], int(r['base_n']))
+    kf = float(r['karp_flatt']) if r['karp_flatt'] else None
+    series[key].append((int(r['threads']), int(r['n']), float(r['median']) * 1000,
+                        float(r['speedup']), float(r['efficiency']), kf))
 
-# 并行时间/ms
-parallel_times = [82.391, 216.58, 438.493]
+for program, kernel in sorted({(k[0], k[1]) for k in series}):
+    title = '%s (%s)' % (program, kernel)
+    strong = {k[3]: sorted(v) for k, v in series.items() if k[:3] == (program, kernel, 'strong')}
+    weak = {k[3]: sorted(v) for k, v in series.items() if k[:3] == (program, kernel, 'weak')}
+    threads = sorted({p[0] for v in strong.values() for p in v})
 
-# 加速比
-speedups = []
-for i in range(len(problem_sizes)):
-    speedups.append(serial_times[i]/parallel_times[i])
+    # 各线程数的时间随规模变化
+    plt.figure(figsize=(10, 6))
+    for t in threads:
+        points = sorted((n, p[2]) for n, v in strong.items() for p in v if p[0] == t)
+        plt.plot([p[0] for p in points], [p[1] for p in points], marker='o', label='%d threads' % t)
+    plt.xlabel('Problem Size')
+    plt.ylabel('Time (ms)')
+    plt.title(title + ': Time vs Problem Size')
+    plt.legend()
+    plt.grid(True)
+    plt.show()
 
-# 绘制串行时间和并行时间
-plt.figure(figsize=(10, 6))
-plt.plot(problem_sizes, serial_times, marker='o', label='Serial Time')
-plt.plot(problem_sizes, parallel_times, marker='o', label='Parallel Time')
-plt.xlabel('Problem Size')
-plt.ylabel('Time (ms)')
-plt.title('Serial Time vs Parallel Time')
-plt.legend()
-plt.grid(True)
-plt.show()
+    # 强扩展：加速比、效率、Karp-Flatt 随线程数变化，每个规模一条线
+    fig, (ax_s, ax_e, ax_k) = plt.subplots(1, 3, figsize=(18, 6))
+    ax_s.plot(threads, threads, 'k--', label='Ideal')
+    for n, v in sorted(strong.items()):
+        ax_s.plot([p[0] for p in v], [p[3] for p in v], marker='o', label='n = %d' % n)
+        ax_e.plot([p[0] for p in v], [p[4] for p in v], marker='o', label='n = %d' % n)
+        kf = [p for p in v if p[5] is not None]
+        ax_k.plot([p[0] for p in kf], [p[5] for p in kf], marker='o', label='n = %d' % n)
+    for ax, name in ((ax_s, 'Speedup'), (ax_e, 'Efficiency'), (ax_k, 'Karp-Flatt Serial Fraction')):
+        ax.set_xlabel('Threads')
+        ax.set_ylabel(name)
+        ax.set_title(title + ': Strong Scaling ' + name)
+        ax.legend()
+        ax.grid(True)
+    plt.show()
 
-# 绘制加速比
-plt.figure(figsize=(10, 6))
-plt.plot(problem_sizes, speedups, marker='o')
-plt.xlabel('Problem Size')
-plt.ylabel('Speedup')
-plt.title('Speedup vs Problem Size')
-plt.grid(True)
-plt.show()
+    # 弱扩展：每线程工作量不变时的效率
+    if weak:
+        plt.figure(figsize=(10, 6))
+        for n, v in sorted(weak.items()):
+            plt.plot([p[0] for p in v], [p[4] for p in v], marker='o', label='n = %d at 1 thread' % n)
+        plt.xlabel('Threads')
+        plt.ylabel('Efficiency')
+        plt.title(title + ': Weak Scaling Efficiency')
+        plt.legend()
+        plt.grid(True)
+        plt.show()
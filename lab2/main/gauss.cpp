@@ -15,6 +15,8 @@
 #define USE_SSE4
 #endif
 
+#include "../../common/perf.h" // PERF=1 时在时间后输出硬件计数器（每次运行的平均值）
+
 #ifndef N
 #define N 1024
 #endif
@@ -32,14 +34,18 @@ void test(void (*func)(ele_t[N][N], int), const char *msg, ele_t mat[N][N], int
     timespec start, end;
     double time_used = 0;
     // cout << "result: " << func(arr, len) << "    ";
+    perf_sample counters;
+    perf_start(counters);
     clock_gettime(CLOCK_REALTIME, &start);
     // for (int i = 0; i < REPT*(int)pow(2,(20-(int)(log2(len)))); i++)
     for (int i = 0; i < REPT; i++)
         func(mat, len);
     clock_gettime(CLOCK_REALTIME, &end);
+    perf_stop(counters);
     time_used += end.tv_sec - start.tv_sec;
     time_used += double(end.tv_nsec - start.tv_nsec) / 1000000000;
     cout << time_used << ',';
+    perf_csv(cout, counters, REPT);
 }
 
 void LU(ele_t mat[N][N], int n)
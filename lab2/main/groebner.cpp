@@ -19,6 +19,8 @@
 #define USE_SSE4
 #endif
 
+#include "../../common/perf.h" // PERF=1 时在时间后输出硬件计数器（每次运行的平均值）
+
 // #ifndef DATA
 // #define DATA "./Groebner/1_130_22_8/"
 // #define COL 130
@@ -76,14 +78,18 @@ void test(void (*func)(mat_t[COL][COL / mat_L + 1], mat_t[ROW][COL / mat_L + 1])
     timespec start, end;
     double time_used = 0;
     // cout << "result: " << func(arr, len) << "    ";
+    perf_sample counters;
+    perf_start(counters);
     clock_gettime(CLOCK_REALTIME, &start);
     // for (int i = 0; i < REPT*(int)pow(2,(20-(int)(log2(len)))); i++)
     for (int i = 0; i < REPT; i++)
         func(ele, row);
     clock_gettime(CLOCK_REALTIME, &end);
+    perf_stop(counters);
     time_used += end.tv_sec - start.tv_sec;
     time_used += double(end.tv_nsec - start.tv_nsec) / 1000000000;
     cout << time_used << ',';
+    perf_csv(cout, counters, REPT);
 }
 
 void groebner(mat_t ele[COL][COL / mat_L + 1], mat_t row[ROW][COL / mat_L + 1])
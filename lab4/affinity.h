@@ -0,0 +1,212 @@
+// 线程绑核与NUMA内存放置，gauss.cpp 和 groebner.cpp 共用
+// 运行时由环境变量控制，不设置时行为与以前相同：
+//   AFFINITY=compact   线程依次填满一个NUMA节点的核再用下一个节点
+//   AFFINITY=scatter   线程轮流放到各个节点上
+//   NUMA_POLICY=local      页面分配在首次访问它的线程所在节点（配合各线程拷贝自己的行）；
+//                          即 MPOL_LOCAL，与内核默认的首次访问策略相同，只在进程继承了其他策略
+//                          （如 numactl --interleave 启动）时用来把这些数组恢复为首次访问
+//   NUMA_POLICY=interleave 页面在所有节点间交错分配
+// 只用系统调用和 /sys 下的拓扑信息，不依赖 libnuma
+#ifndef AFFINITY_H
+#define AFFINITY_H
+
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <iostream>
+
+#ifndef MPOL_DEFAULT
+#define MPOL_DEFAULT 0
+#define MPOL_INTERLEAVE 3
+#define MPOL_LOCAL 4
+#define MPOL_MF_MOVE (1 << 1)
+#endif
+
+struct topology
+{
+    int nnode;
+    std::vector<int> cpus;    // 在线的CPU编号
+    std::vector<int> node_of; // CPU编号 -> NUMA节点
+    std::vector<int> order;   // 按 AFFINITY 排好的绑核顺序，为空表示不绑核
+    const char *affinity;
+    const char *policy;
+};
+
+static inline int read_int(const std::string &path, int dflt)
+{
+    FILE *f = fopen(path.c_str(), "r");
+    int v = dflt;
+    if (f)
+    {
+        if (fscanf(f, "%d", &v) != 1)
+            v = dflt;
+        fclose(f);
+    }
+    return v;
+}
+
+// 解析 "0-3,8-11" 形式的CPU列表
+static inline std::vector<int> read_cpulist(const std::string &path)
+{
+    std::vector<int> list;
+    FILE *f = fopen(path.c_str(), "r");
+    if (!f)
+        return list;
+    int a, b;
+    while (fscanf(f, "%d", &a) == 1)
+    {
+        b = a;
+        if (fgetc(f) == '-')
+        {
+            if (fscanf(f, "%d", &b) != 1)
+                b = a;
+            fgetc(f);
+        }
+        for (int c = a; c <= b; c++)
+            list.push_back(c);
+    }
+    fclose(f);
+    return list;
+}
+
+static inline topology &topo()
+{
+    static topology t;
+    static bool ready = false;
+    if (ready)
+        return t;
+    ready = true;
+
+    t.cpus = read_cpulist("/sys/devices/system/cpu/online");
+    if (t.cpus.empty())
+        for (int c = 0; c < sysconf(_SC_NPROCESSORS_ONLN); c++)
+            t.cpus.push_back(c);
+    int max_cpu = *std::max_element(t.cpus.begin(), t.cpus.end());
+    t.node_of.assign(max_cpu + 1, 0);
+    t.nnode = 1;
+    for (int node = 0;; node++)
+    {
+        std::vector<int> list = read_cpulist("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+        if (list.empty())
+            break;
+        t.nnode = node + 1;
+        for (int c : list)
+            if (c <= max_cpu)
+                t.node_of[c] = node;
+    }
+
+    t.affinity = getenv("AFFINITY");
+    t.policy = getenv("NUMA_POLICY");
+    if (t.affinity && (!strcmp(t.affinity, "compact") || !strcmp(t.affinity, "scatter")))
+    {
+        // compact：按 (节点, 核, 超线程) 排序，先用满同一节点的物理核
+        std::vector<std::pair<long, int>> keyed;
+        std::vector<long> seen; // 已出现的 (封装, 核)
+        for (int c : t.cpus)
+        {
+            std::string base = "/sys/devices/system/cpu/cpu" + std::to_string(c) + "/topology/";
+            long core = ((long)read_int(base + "physical_package_id", 0) << 20) | read_int(base + "core_id", c);
+            // 同一物理核的第二个超线程排在该节点所有物理核之后
+            long smt = std::count(seen.begin(), seen.end(), core);
+            seen.push_back(core);
+            keyed.push_back({((long)t.node_of[c] << 40) | (smt << 32) | core, c});
+        }
+        std::sort(keyed.begin(), keyed.end());
+        for (auto &k : keyed)
+            t.order.push_back(k.second);
+        if (!strcmp(t.affinity, "scatter"))
+        { // scatter：各节点的第1个核、各节点的第2个核……
+            std::vector<std::vector<int>> per_node(t.nnode);
+            for (int c : t.order)
+                per_node[t.node_of[c]].push_back(c);
+            t.order.clear();
+            for (size_t r = 0; t.order.size() < t.cpus.size(); r++)
+                for (int node = 0; node < t.nnode; node++)
+                    if (r < per_node[node].size())
+                        t.order.push_back(per_node[node][r]);
+        }
+    }
+    else
+        t.affinity = NULL;
+    if (t.policy && strcmp(t.policy, "local") && strcmp(t.policy, "interleave"))
+        t.policy = NULL;
+    return t;
+}
+
+// 第th个工作线程的创建属性，不绑核时返回NULL（即默认属性）
+static inline const pthread_attr_t *thread_attr(int th)
+{
+    static std::vector<pthread_attr_t> attrs;
+    topology &t = topo();
+    if (t.order.empty())
+        return NULL;
+    if (attrs.empty())
+    {
+        attrs.resize(t.order.size());
+        for (size_t i = 0; i < t.order.size(); i++)
+        {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(t.order[i], &set);
+            pthread_attr_init(&attrs[i]);
+            pthread_attr_setaffinity_np(&attrs[i], sizeof(set), &set);
+        }
+    }
+    return &attrs[th % attrs.size()];
+}
+
+// 对 [addr, addr+len) 设置 NUMA_POLICY 指定的内存策略，已分配的页面会被迁移
+static inline void place_memory(void *addr, size_t len)
+{
+    topology &t = topo();
+    if (!t.policy || t.nnode < 2)
+        return;
+    long page = sysconf(_SC_PAGESIZE);
+    char *begin = (char *)((unsigned long)addr / page * page);
+    len += (char *)addr - begin;
+    unsigned long mask = t.nnode >= 64 ? ~0UL : (1UL << t.nnode) - 1;
+    if (!strcmp(t.policy, "interleave"))
+        syscall(SYS_mbind, begin, len, MPOL_INTERLEAVE, &mask, (unsigned long)t.nnode + 1, MPOL_MF_MOVE);
+    else // 与默认策略相同，覆盖继承来的策略
+        syscall(SYS_mbind, begin, len, MPOL_LOCAL, NULL, 0UL, 0);
+}
+
+// 输出拓扑与放置情况：节点数,CPU数,绑核方式,内存策略,各节点的线程数,各节点的页数（抽样）,
+// 只有设置了 AFFINITY 或 NUMA_POLICY 时才输出，默认的CSV格式不变
+static inline void report_placement(void *addr, size_t len, int nthreads)
+{
+    topology &t = topo();
+    if (!t.affinity && !t.policy)
+        return;
+    std::cout << t.nnode << ',' << t.cpus.size() << ',' << (t.affinity ? t.affinity : "none") << ','
+              << (t.policy ? t.policy : "default") << ',';
+
+    std::vector<int> threads(t.nnode, 0);
+    for (int th = 0; th < nthreads; th++)
+        threads[t.order.empty() ? 0 : t.node_of[t.order[th % t.order.size()]]]++;
+    for (int node = 0; node < t.nnode; node++)
+        std::cout << (t.order.empty() ? "-" : std::to_string(threads[node])) << (node + 1 < t.nnode ? "/" : ",");
+
+    // 用 move_pages 的查询模式抽样统计页面所在节点
+    long page = sysconf(_SC_PAGESIZE);
+    const int samples = 256;
+    std::vector<void *> pages;
+    for (int s = 0; s < samples; s++)
+        pages.push_back((char *)addr + (size_t)((double)s / samples * len) / page * page);
+    std::vector<int> status(samples, -1), pages_on(t.nnode, 0);
+    if (syscall(SYS_move_pages, 0, (unsigned long)samples, pages.data(), NULL, status.data(), 0) == 0)
+        for (int s : status)
+            if (s >= 0 && s < t.nnode)
+                pages_on[s]++;
+    for (int node = 0; node < t.nnode; node++)
+        std::cout << pages_on[node] << (node + 1 < t.nnode ? "/" : ",");
+}
+
+#endif
@@ -0,0 +1,145 @@
+// 计时框架，gauss.cpp 和 groebner.cpp 共用
+// 每个内核先预热 WARMUP 次，再计时 REPT 次，统计最小值/中位数/平均值/标准差；
+// 标准输出仍只打印中位数加逗号，与以前的CSV兼容。
+// 设置环境变量 BENCH_OUT 后，每次测试再向该文件追加一条带元数据的记录：
+//   BENCH_OUT=result.csv    CSV，文件为空时先写表头
+//   BENCH_OUT=result.json   JSON Lines，每行一个对象
+// 环境变量 BENCH_REPT / BENCH_WARMUP 覆盖编译时的次数，lab2/datav/bench.py 可直接读取输出画图
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include "../common/perf.h"
+
+#ifndef REPT
+#define REPT 5 // 单次计时受频率爬升、缺页等干扰太大，默认取5次的中位数
+#endif
+#ifndef WARMUP
+#define WARMUP 1
+#endif
+
+// 编译目标的指令集
+#if defined(__AVX512F__)
+#define BENCH_ISA "avx512"
+#elif defined(__AVX2__)
+#define BENCH_ISA "avx2"
+#elif defined(__ARM_NEON)
+#define BENCH_ISA "neon"
+#elif defined(__SSE4_1__)
+#define BENCH_ISA "sse4"
+#else
+#define BENCH_ISA "sse2"
+#endif
+
+struct bench_result
+{
+    int reps;
+    double min, median, mean, stddev; // 秒
+    perf_sample perf;                 // PERF=1 时为全部计时运行的计数器之和
+};
+
+inline double bench_now()
+{
+    timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+inline int bench_env(const char *name, int dflt)
+{
+    const char *v = getenv(name);
+    return v ? atoi(v) : dflt;
+}
+
+// repeatable 为 false 时（如原地消去会覆盖输入）只计时一次、不预热
+template <typename F>
+bench_result bench(F run, bool repeatable = true)
+{
+    int warmup = repeatable ? bench_env("BENCH_WARMUP", WARMUP) : 0;
+    int reps = repeatable ? std::max(bench_env("BENCH_REPT", REPT), 1) : 1;
+    for (int r = 0; r < warmup; r++)
+        run();
+    std::vector<double> t(reps);
+    bench_result res;
+    perf_start(res.perf);
+    for (int r = 0; r < reps; r++)
+    {
+        double start = bench_now();
+        run();
+        t[r] = bench_now() - start;
+    }
+    perf_stop(res.perf);
+    res.reps = reps;
+    res.mean = 0;
+    for (double x : t)
+        res.mean += x;
+    res.mean /= reps;
+    res.stddev = 0;
+    for (double x : t)
+        res.stddev += (x - res.mean) * (x - res.mean);
+    res.stddev = reps > 1 ? sqrt(res.stddev / (reps - 1)) : 0;
+    std::sort(t.begin(), t.end());
+    res.min = t[0];
+    res.median = reps % 2 ? t[reps / 2] : (t[reps / 2 - 1] + t[reps / 2]) / 2;
+    return res;
+}
+
+// 追加一条记录；work 为一次运行的工作量（浮点运算数或字节数），rate 按中位数时间计算，单位为 unit（如 GFLOP/s）
+inline void bench_record(const char *program, const char *kernel, int n, int threads, const char *isa,
+                         double work, const char *unit, const bench_result &r)
+{
+    const char *path = getenv("BENCH_OUT");
+    if (!path)
+        return;
+    // 去掉 "NEON/SSE: " 这类提示文字末尾的冒号和空格
+    std::string name = kernel;
+    while (!name.empty() && (name.back() == ' ' || name.back() == ':'))
+        name.pop_back();
+    double rate = work / r.median / 1e9;
+    size_t len = strlen(path);
+    bool json = len >= 5 && (!strcmp(path + len - 5, ".json") || (len >= 6 && !strcmp(path + len - 6, ".jsonl")));
+
+    FILE *f = fopen(path, "a");
+    if (!f)
+    {
+        perror(path);
+        return;
+    }
+    fseek(f, 0, SEEK_END);
+    // 硬件计数器按每次运行的平均值记录，未启用或不可用时CSV留空、JSON省略
+    std::string counters_csv, counters_json;
+    for (int e = 0; e < PERF_EVENTS; e++)
+    {
+        bool ok = perf_enabled() && r.perf.v[e] >= 0;
+        std::string v = ok ? std::to_string((unsigned long long)(r.perf.v[e] / r.reps)) : "";
+        counters_csv += "," + v;
+        if (ok)
+            counters_json += std::string(", \"") + perf_names[e] + "\": " + v;
+    }
+    if (json)
+        fprintf(f, "{\"program\": \"%s\", \"kernel\": \"%s\", \"n\": %d, \"threads\": %d, \"isa\": \"%s\", \"reps\": %d, "
+                   "\"min\": %.9g, \"median\": %.9g, \"mean\": %.9g, \"stddev\": %.9g, \"rate\": %.6g, \"unit\": \"%s\"%s}\n",
+                program, name.c_str(), n, threads, isa, r.reps, r.min, r.median, r.mean, r.stddev, rate, unit, counters_json.c_str());
+    else
+    {
+        if (ftell(f) == 0)
+        {
+            fprintf(f, "program,kernel,n,threads,isa,reps,min,median,mean,stddev,rate,unit");
+            for (int e = 0; e < PERF_EVENTS; e++)
+                fprintf(f, ",%s", perf_names[e]);
+            fprintf(f, "\n");
+        }
+        fprintf(f, "%s,%s,%d,%d,%s,%d,%.9g,%.9g,%.9g,%.9g,%.6g,%s%s\n",
+                program, name.c_str(), n, threads, isa, r.reps, r.min, r.median, r.mean, r.stddev, rate, unit, counters_csv.c_str());
+    }
+    fclose(f);
+}
+
+#endif
@@ -1,32 +1,195 @@
 #include <iostream>
-#include <fstream>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <vector>
+#include "gauss_dat.h"
 
+// 生成 gauss.dat：64 字节文件头（记录 n，见 gauss_dat.h）之后为 n*n 个 float，按行存放
+// 用法：./datagen [-n 4096] [-dist rand|uniform|normal|const|arith|ramp] [-value v]
+//                 [-dom d] [-cond k] [-seed s] [-threads t] [-o gauss.dat]
+//   rand     [0, 2^31) 的整数（以前的默认），uniform [-1,1) 均匀分布，normal 标准正态分布
+//   const    全部为 value（以前的 -DR），arith 从1开始每个元素加 value（-DRP），
+//   ramp     从1开始依次加 value, value+1, ...（-DRC）
+//   -dom d   对角元改为 d 倍的该行其余元素绝对值之和，d>1 时严格对角占优，不选主元也稳定
+//   -cond k  第j列乘以 k^(-j/(n-1))，在良态（如对角占优）矩阵上得到条件数约为 k 的矩阵
+// 每个元素由 (seed, 行, 列) 经计数器式随机数生成，与线程数无关，各线程直接写入映射的输出文件
+#ifndef N
 #define N 4096
+#endif
 
 using namespace std;
 
-int main()
+int n = N;
+const char *dist = "rand";
+const char *dists[] = {"rand", "uniform", "normal", "const", "arith", "ramp"};
+int dist_id;
+double value = 1;
+double dom = 0;
+double cond = 0;
+uint64_t seed = 314159265;
+int nthreads = 0;
+const char *out = "gauss.dat";
+float *mat;
+vector<double> col_scale; // -cond 的列缩放系数
+
+// SplitMix64 的混合函数：对计数器做一次哈希即得到该位置的随机数
+inline uint64_t mix(uint64_t x)
 {
-        ofstream data("gauss.dat", ios::out | ios::binary);
-        srand(314159265);
-        float r = 1;
-#ifdef RC
-        int rc = RC;
-#endif
-        for (int i = 0; i < (N * N); i++)
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+// 第 k 个元素的第 s 个随机数，落在 [0,1)
+inline double uniform01(uint64_t k, int s)
+{
+    return (mix(seed ^ mix(k * 2 + s)) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+inline float element(uint64_t k)
+{
+    switch (dist_id)
+    {
+    case 1:
+        return 2 * uniform01(k, 0) - 1;
+    case 2:
+    { // Box-Muller
+        double u = uniform01(k, 0), v = uniform01(k, 1);
+        return sqrt(-2 * log(1 - u)) * cos(2 * M_PI * v);
+    }
+    case 3:
+        return value;
+    case 4:
+        return 1 + value * (k + 1);
+    case 5: // 1 + value + (value+1) + ... 共 k+1 项
+        return 1 + value * (k + 1) + (double)k * (k + 1) / 2;
+    default:
+        return mix(seed ^ mix(k)) >> 33;
+    }
+}
+
+struct gen_data
+{
+    int begin, end;
+};
+
+void *subthread_gen(void *_params)
+{
+    gen_data *params = (gen_data *)_params;
+    for (int i = params->begin; i < params->end; i++)
+    {
+        float *row = mat + (size_t)i * n;
+        for (int j = 0; j < n; j++)
+            row[j] = element((uint64_t)i * n + j);
+        if (dom > 0)
         {
-#ifdef R
-                r = R;
-#elif RP
-                r = r + RP;
-#elif RC
-                r = r + rc;
-                rc++;
-#else
-                r = (float)rand();
-#endif
-                // cout << r << ' ';
-                data.write((char *)&r, sizeof(r));
+            double off = 0;
+            for (int j = 0; j < n; j++)
+                if (j != i)
+                    off += fabs(row[j]);
+            row[i] = (row[i] < 0 ? -dom : dom) * off;
         }
-        data.close();
-}
\ No newline at end of file
+        if (cond > 0)
+            for (int j = 0; j < n; j++)
+                row[j] *= col_scale[j];
+    }
+    return NULL;
+}
+
+void usage()
+{
+    cout << "usage: ./datagen [-n 4096] [-dist rand|uniform|normal|const|arith|ramp] [-value v]" << endl
+         << "                 [-dom d] [-cond k] [-seed s] [-threads t] [-o gauss.dat]" << endl;
+}
+
+int main(int argc, char *argv[])
+{
+    for (int a = 1; a < argc; a += 2)
+    {
+        if (a + 1 == argc) // 每个选项都带一个值
+        {
+            cout << "missing value for " << argv[a] << endl;
+            usage();
+            return -1;
+        }
+        if (!strcmp(argv[a], "-n"))
+            n = atoi(argv[a + 1]);
+        else if (!strcmp(argv[a], "-dist"))
+            dist = argv[a + 1];
+        else if (!strcmp(argv[a], "-value"))
+            value = atof(argv[a + 1]);
+        else if (!strcmp(argv[a], "-dom"))
+            dom = atof(argv[a + 1]);
+        else if (!strcmp(argv[a], "-cond"))
+            cond = atof(argv[a + 1]);
+        else if (!strcmp(argv[a], "-seed"))
+            seed = strtoull(argv[a + 1], NULL, 10);
+        else if (!strcmp(argv[a], "-threads"))
+            nthreads = atoi(argv[a + 1]);
+        else if (!strcmp(argv[a], "-o"))
+            out = argv[a + 1];
+        else
+        {
+            cout << "unknown option " << argv[a] << endl;
+            usage();
+            return -1;
+        }
+    }
+    if (nthreads <= 0)
+        nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+    dist_id = -1;
+    for (int d = 0; d < 6; d++)
+        if (!strcmp(dist, dists[d]))
+            dist_id = d;
+    if (dist_id < 0)
+    {
+        cout << "unknown distribution " << dist << endl;
+        return -1;
+    }
+    if (cond > 0)
+        for (int j = 0; j < n; j++)
+            col_scale.push_back(pow(cond, -(double)j / (n > 1 ? n - 1 : 1)));
+
+    // 输出文件先扩展到最终大小再映射，各线程直接写各自的行，不再逐元素 write
+    size_t bytes = sizeof(gauss_header) + (size_t)n * n * sizeof(float);
+    int fd = open(out, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || ftruncate(fd, bytes))
+    {
+        perror(out);
+        return -1;
+    }
+    char *file = (char *)mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (file == MAP_FAILED)
+    {
+        perror("mmap");
+        return -1;
+    }
+    gauss_header h = make_gauss_header(n);
+    memcpy(file, &h, sizeof(h));
+    mat = (float *)(file + sizeof(h));
+
+    vector<pthread_t> threads(nthreads);
+    vector<gen_data> attr(nthreads);
+    for (int th = 0; th < nthreads; th++)
+    {
+        attr[th] = {(int)((long)th * n / nthreads), (int)((long)(th + 1) * n / nthreads)};
+        int err = pthread_create(&threads[th], NULL, subthread_gen, (void *)&attr[th]);
+        if (err)
+        {
+            cout << "failed to create thread[" << th << "]" << endl;
+            exit(-1);
+        }
+    }
+    for (int th = 0; th < nthreads; th++)
+        pthread_join(threads[th], NULL);
+
+    munmap(file, bytes);
+    close(fd);
+}
@@ -1,11 +1,19 @@
 #include <pthread.h>
 #include <iostream>
-#include <fstream>
 #include <iomanip>
 #include <time.h>
 #include <sys/time.h>
 #include <cmath>
 #include <string.h>
+#include <atomic>
+#include <sched.h>
+#include <stdint.h>
+#include <float.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <type_traits>
 
 #ifdef __ARM_NEON
 #include <arm_neon.h>
@@ -17,37 +25,201 @@
 #define USE_SSE4
 #endif
 
+#include "affinity.h"
+#include "gauss_dat.h"
+#include "bench.h"
+#include "scaling.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#ifdef PSTL
+#pragma push_macro("N") // 命令行的 -DN 会与 TBB 头文件中的模板参数名冲突
+#undef N
+#include <execution>
+#include <numeric>
+#pragma pop_macro("N")
+#endif
+
 #define ZERO (float)1e-5
 #ifndef N
 #define N 4096
-#define NUM_THREADS 20
 #endif
-#define REPT 1
+#ifndef NUM_THREADS
+#define NUM_THREADS 20 // 线程数上限，决定线程数组大小；运行时的线程数为 nthreads
+#endif
+#ifndef ele_t
 #define ele_t float
+#endif
+static_assert(std::is_same<ele_t, float>::value || std::is_same<ele_t, double>::value,
+              "ele_t must be float or double: row_update only has _ps/_pd kernels");
+#define MAX_REFINE 10
+#ifndef NRHS
+#define NRHS 4 // 完整求解时同时求解的右端项个数
+#endif
+#define SOLVE_BLOCK 64 // 并行回代每块的行数，每块同步一次
+#if defined(__AVX512F__)
+#define VEC_BYTES 64 // row_update 一个向量的字节数
+#elif defined(__AVX__)
+#define VEC_BYTES 32
+#else
+#define VEC_BYTES 16
+#endif
+#define VEC_PS (VEC_BYTES / 4)                   // 一个向量的 float 个数
+#define VEC_PD (VEC_BYTES / 8)                   // 一个向量的 double 个数
+#define VEC_LEN (VEC_BYTES / (int)sizeof(ele_t)) // 一个向量的 ele_t 个数
+#define UNROLL 4 // row_update 主体每次处理的向量数
 // #define DEBUG
+// #define CHECK // 输出消去结果相对长双精度参考解的误差
+// #define SOLVE // 测试float/double/混合精度求解 Ax=b，以及带 NRHS 个右端项的并行完整求解（分阶段计时）
+// #define PARTITION // 比较行划分、列划分、二维块划分
+// #define PIPELINE // 测试流水线消去
+// #define PSTL // 编译 std::execution::par_unseq 版本，GCC 需要 -std=c++17 -ltbb
+// #define IN_PLACE // 原地消去，不保留输入矩阵（输入被覆盖，只测一个函数）
 
 using namespace std;
 
-ele_t new_mat[N][N] __attribute__((aligned(64)));
-ele_t mat[N][N];
+ele_t new_buf[N][N] __attribute__((aligned(64)));
+int nthreads = NUM_THREADS; // 运行时的线程数，扩展性扫描时逐个修改
+ele_t (*mat)[N];                // 输入矩阵：只读映射 gauss.dat 的数据部分，见 load_input
+ele_t (*new_mat)[N] = new_buf; // 工作矩阵：保留输入时为 new_buf，原地消去时为输入矩阵本身
+#ifdef IN_PLACE
+bool preserve_input = false;
+#else
+bool preserve_input = true;
+#endif
+
+// bf16 只作为存储格式，读出时扩展为 float 参与运算
+struct bf16_t
+{
+    uint16_t bits;
+    bf16_t() = default;
+    bf16_t(float f)
+    {
+        uint32_t u;
+        memcpy(&u, &f, sizeof(u));
+        u += 0x7fff + ((u >> 16) & 1); // 舍入到最近偶数
+        bits = u >> 16;
+    }
+    operator float() const
+    {
+        uint32_t u = (uint32_t)bits << 16;
+        float f;
+        memcpy(&f, &u, sizeof(f));
+        return f;
+    }
+};
+
+// 存储类型 -> 运算类型
+template <typename T>
+struct acc_of
+{
+    typedef T type;
+};
+template <>
+struct acc_of<bf16_t>
+{
+    typedef float type;
+};
+#ifdef __FLT16_MAX__
+typedef _Float16 fp16_t;
+template <>
+struct acc_of<fp16_t>
+{
+    typedef float type;
+};
+#endif
+
+template <typename T>
+using row_t = T[N];
+
+int perm[N]; // 选主元后逻辑第i行对应的物理行，换行只交换下标
+ele_t rhs_buf[N][NRHS] __attribute__((aligned(64)));
+ele_t (*elim_rhs)[NRHS] = NULL; // 非空时选主元消去同时对这些右端项做同样的行变换（按物理行存放）
+
+// 在 perm[i..n) 中找第i列绝对值最大的行并交换到第i位，主元过小返回false
+template <typename T>
+inline bool select_pivot(row_t<T> *a, int *p, int i, int n)
+{
+    int best = i;
+    double best_v = fabs((double)(typename acc_of<T>::type)a[p[i]][i]);
+    for (int r = i + 1; r < n; r++)
+    {
+        double v = fabs((double)(typename acc_of<T>::type)a[p[r]][i]);
+        if (v > best_v)
+        {
+            best_v = v;
+            best = r;
+        }
+    }
+    swap(p[i], p[best]);
+    return best_v > ZERO;
+}
+
+// 选定工作矩阵，保留输入时具体的拷贝由 copy_rows 完成
+inline void prepare(ele_t mat[N][N])
+{
+    new_mat = preserve_input ? new_buf : mat;
+}
+
+// 拷贝 [begin, end) 中每隔 step 的一行，只拷前n列；
+// 由之后负责这些行的线程调用，页面按首次访问分配到该线程所在的节点
+inline void copy_rows(ele_t mat[N][N], int n, int begin, int end, int step = 1)
+{
+    if (!preserve_input)
+        return;
+    for (int j = begin; j < end; j += step)
+        memcpy(new_mat[j], mat[j], sizeof(ele_t) * n);
+}
+
+struct copy_data
+{
+    ele_t (*src)[N];
+    int n, begin, end;
+};
+
+void *subthread_copy(void *_params)
+{
+    copy_data *params = (copy_data *)_params;
+    copy_rows(params->src, params->n, params->begin, params->end);
+    return NULL;
+}
+
+// 按连续行块并行拷贝，供行划分随步数变化的内核使用
+void parallel_copy(ele_t mat[N][N], int n)
+{
+    if (!preserve_input)
+        return;
+    pthread_t threads[NUM_THREADS];
+    copy_data attr[NUM_THREADS];
+    for (int th = 0; th < nthreads; th++)
+    {
+        attr[th] = {mat, n, th * n / nthreads, (th + 1) * n / nthreads};
+        int err = pthread_create(&threads[th], thread_attr(th), subthread_copy, (void *)&attr[th]);
+        if (err)
+        {
+            cout << "failed to create thread[" << th << "]" << endl;
+            exit(-1);
+        }
+    }
+    for (int th = 0; th < nthreads; th++)
+        pthread_join(threads[th], NULL);
+}
 
-void test(void (*func)(ele_t[N][N], int), const char *msg, ele_t mat[N][N], int len)
+// work 为一次运行的浮点运算数，默认为消去的 2n^3/3
+void test(void (*func)(ele_t[N][N], int), const char *msg, ele_t mat[N][N], int len, double work = 0)
 {
-    timespec start, end;
-    double time_used = 0;
-    clock_gettime(CLOCK_REALTIME, &start);
-    // for (int i = 0; i < REPT*(int)pow(2,(20-(int)(log2(len)))); i++)
-    for (int i = 0; i < REPT; i++)
-        func(mat, len);
-    clock_gettime(CLOCK_REALTIME, &end);
-    time_used += end.tv_sec - start.tv_sec;
-    time_used += double(end.tv_nsec - start.tv_nsec) / 1000000000;
-    cout << time_used << ',';
+    bench_result r = bench([&]
+                           { func(mat, len); },
+                           preserve_input);
+    cout << r.median << ',';
+    perf_csv(cout, r.perf, r.reps);
+    bench_record("gauss", msg, len, nthreads, BENCH_ISA, work > 0 ? work : 2.0 / 3 * len * len * len, "GFLOP/s", r);
 }
 
 void LU(ele_t mat[N][N], int n)
 {
-    memcpy(new_mat, mat, sizeof(ele_t) * N * N);
+    prepare(mat);
+    copy_rows(mat, n, 0, n);
 
     for (int i = 0; i < n; i++)
         for (int j = i + 1; j < n; j++)
@@ -71,10 +243,163 @@ void LU(ele_t mat[N][N], int n)
 #endif
 }
 
+// 第i步消去时可以从第i列向前退到 row + k 按向量宽度对齐的列开始：
+// 第j行第i列之前是下三角部分，之后不会再被读取，多算几列不影响结果，换来没有前段的对齐处理
+// 行首 64 字节对齐且 N 为向量宽度整数倍时（new_buf），各行退到的列相同
+inline int aligned_begin(const ele_t *row, int i)
+{
+    int k = i - ((uintptr_t)(row + i) / sizeof(ele_t)) % VEC_LEN;
+    return k < 0 ? i : k;
+}
+
+// mat_j[begin, end) -= mat_i[begin, end) * div，所有 SIMD 消去内核共用
+// 前段逐个处理到 mat_j + k 按向量宽度对齐（AVX-512 用一次掩码操作），之后的存储都不跨缓存行；
+// 主体每次 UNROLL 个互不依赖的向量，多个访存同时在途；
+// 剩余不足一个向量的部分 AVX-512 用掩码，其余逐个处理，任意 n 都不会越过行尾
+// float 和 double 各一个重载，由 ele_t 选择
+__attribute__((always_inline)) inline void row_update(float *mat_j, const float *mat_i, float div, int begin, int end)
+{
+    int k = begin;
+#if defined(__AVX512F__)
+    __m512 d = _mm512_set1_ps(div);
+    int head = (VEC_PS - ((uintptr_t)(mat_j + k) / sizeof(float)) % VEC_PS) % VEC_PS;
+    head = min(head, end - k);
+    if (head > 0)
+    {
+        __mmask16 m = (1u << head) - 1;
+        __m512 r = _mm512_maskz_loadu_ps(m, mat_j + k);
+        r = _mm512_sub_ps(r, _mm512_mul_ps(_mm512_maskz_loadu_ps(m, mat_i + k), d));
+        _mm512_mask_storeu_ps(mat_j + k, m, r);
+        k += head;
+    }
+    for (; k + UNROLL * VEC_PS <= end; k += UNROLL * VEC_PS)
+    {
+        __m512 r0 = _mm512_sub_ps(_mm512_load_ps(mat_j + k), _mm512_mul_ps(_mm512_loadu_ps(mat_i + k), d));
+        __m512 r1 = _mm512_sub_ps(_mm512_load_ps(mat_j + k + 16), _mm512_mul_ps(_mm512_loadu_ps(mat_i + k + 16), d));
+        __m512 r2 = _mm512_sub_ps(_mm512_load_ps(mat_j + k + 32), _mm512_mul_ps(_mm512_loadu_ps(mat_i + k + 32), d));
+        __m512 r3 = _mm512_sub_ps(_mm512_load_ps(mat_j + k + 48), _mm512_mul_ps(_mm512_loadu_ps(mat_i + k + 48), d));
+        _mm512_store_ps(mat_j + k, r0);
+        _mm512_store_ps(mat_j + k + 16, r1);
+        _mm512_store_ps(mat_j + k + 32, r2);
+        _mm512_store_ps(mat_j + k + 48, r3);
+    }
+    for (; k + VEC_PS <= end; k += VEC_PS)
+        _mm512_store_ps(mat_j + k, _mm512_sub_ps(_mm512_load_ps(mat_j + k), _mm512_mul_ps(_mm512_loadu_ps(mat_i + k), d)));
+    if (k < end)
+    {
+        __mmask16 m = (1u << (end - k)) - 1;
+        __m512 r = _mm512_maskz_loadu_ps(m, mat_j + k);
+        r = _mm512_sub_ps(r, _mm512_mul_ps(_mm512_maskz_loadu_ps(m, mat_i + k), d));
+        _mm512_mask_storeu_ps(mat_j + k, m, r);
+    }
+#else
+    for (; k < end && (uintptr_t)(mat_j + k) % (VEC_PS * sizeof(float)); k++)
+        mat_j[k] -= mat_i[k] * div;
+#if defined(__AVX__)
+    __m256 d = _mm256_set1_ps(div);
+    for (; k + UNROLL * VEC_PS <= end; k += UNROLL * VEC_PS)
+    {
+        __m256 r0 = _mm256_sub_ps(_mm256_load_ps(mat_j + k), _mm256_mul_ps(_mm256_loadu_ps(mat_i + k), d));
+        __m256 r1 = _mm256_sub_ps(_mm256_load_ps(mat_j + k + 8), _mm256_mul_ps(_mm256_loadu_ps(mat_i + k + 8), d));
+        __m256 r2 = _mm256_sub_ps(_mm256_load_ps(mat_j + k + 16), _mm256_mul_ps(_mm256_loadu_ps(mat_i + k + 16), d));
+        __m256 r3 = _mm256_sub_ps(_mm256_load_ps(mat_j + k + 24), _mm256_mul_ps(_mm256_loadu_ps(mat_i + k + 24), d));
+        _mm256_store_ps(mat_j + k, r0);
+        _mm256_store_ps(mat_j + k + 8, r1);
+        _mm256_store_ps(mat_j + k + 16, r2);
+        _mm256_store_ps(mat_j + k + 24, r3);
+    }
+    for (; k + VEC_PS <= end; k += VEC_PS)
+        _mm256_store_ps(mat_j + k, _mm256_sub_ps(_mm256_load_ps(mat_j + k), _mm256_mul_ps(_mm256_loadu_ps(mat_i + k), d)));
+    if (k + 4 <= end) // 剩余至少半个向量时先用 128 位处理，逐个处理的最多3个
+    {
+        _mm_store_ps(mat_j + k, _mm_sub_ps(_mm_load_ps(mat_j + k), _mm_mul_ps(_mm_loadu_ps(mat_i + k), _mm256_castps256_ps128(d))));
+        k += 4;
+    }
+#else
+    float32x4_t d = vmovq_n_f32(div);
+    for (; k + UNROLL * VEC_PS <= end; k += UNROLL * VEC_PS)
+    {
+        float32x4_t r0 = vmlsq_f32(vld1q_f32(mat_j + k), d, vld1q_f32(mat_i + k));
+        float32x4_t r1 = vmlsq_f32(vld1q_f32(mat_j + k + 4), d, vld1q_f32(mat_i + k + 4));
+        float32x4_t r2 = vmlsq_f32(vld1q_f32(mat_j + k + 8), d, vld1q_f32(mat_i + k + 8));
+        float32x4_t r3 = vmlsq_f32(vld1q_f32(mat_j + k + 12), d, vld1q_f32(mat_i + k + 12));
+        vst1q_f32(mat_j + k, r0);
+        vst1q_f32(mat_j + k + 4, r1);
+        vst1q_f32(mat_j + k + 8, r2);
+        vst1q_f32(mat_j + k + 12, r3);
+    }
+    for (; k + VEC_PS <= end; k += VEC_PS)
+        vst1q_f32(mat_j + k, vmlsq_f32(vld1q_f32(mat_j + k), d, vld1q_f32(mat_i + k)));
+#endif
+    for (; k < end; k++)
+        mat_j[k] -= mat_i[k] * div;
+#endif
+}
+
+// double 版本，结构同上；没有 AVX 时交给编译器向量化
+__attribute__((always_inline)) inline void row_update(double *mat_j, const double *mat_i, double div, int begin, int end)
+{
+    int k = begin;
+#if defined(__AVX512F__)
+    __m512d d = _mm512_set1_pd(div);
+    int head = (VEC_PD - ((uintptr_t)(mat_j + k) / sizeof(double)) % VEC_PD) % VEC_PD;
+    head = min(head, end - k);
+    if (head > 0)
+    {
+        __mmask8 m = (1u << head) - 1;
+        __m512d r = _mm512_maskz_loadu_pd(m, mat_j + k);
+        r = _mm512_sub_pd(r, _mm512_mul_pd(_mm512_maskz_loadu_pd(m, mat_i + k), d));
+        _mm512_mask_storeu_pd(mat_j + k, m, r);
+        k += head;
+    }
+    for (; k + UNROLL * VEC_PD <= end; k += UNROLL * VEC_PD)
+    {
+        __m512d r0 = _mm512_sub_pd(_mm512_load_pd(mat_j + k), _mm512_mul_pd(_mm512_loadu_pd(mat_i + k), d));
+        __m512d r1 = _mm512_sub_pd(_mm512_load_pd(mat_j + k + 8), _mm512_mul_pd(_mm512_loadu_pd(mat_i + k + 8), d));
+        __m512d r2 = _mm512_sub_pd(_mm512_load_pd(mat_j + k + 16), _mm512_mul_pd(_mm512_loadu_pd(mat_i + k + 16), d));
+        __m512d r3 = _mm512_sub_pd(_mm512_load_pd(mat_j + k + 24), _mm512_mul_pd(_mm512_loadu_pd(mat_i + k + 24), d));
+        _mm512_store_pd(mat_j + k, r0);
+        _mm512_store_pd(mat_j + k + 8, r1);
+        _mm512_store_pd(mat_j + k + 16, r2);
+        _mm512_store_pd(mat_j + k + 24, r3);
+    }
+    for (; k + VEC_PD <= end; k += VEC_PD)
+        _mm512_store_pd(mat_j + k, _mm512_sub_pd(_mm512_load_pd(mat_j + k), _mm512_mul_pd(_mm512_loadu_pd(mat_i + k), d)));
+    if (k < end)
+    {
+        __mmask8 m = (1u << (end - k)) - 1;
+        __m512d r = _mm512_maskz_loadu_pd(m, mat_j + k);
+        r = _mm512_sub_pd(r, _mm512_mul_pd(_mm512_maskz_loadu_pd(m, mat_i + k), d));
+        _mm512_mask_storeu_pd(mat_j + k, m, r);
+    }
+#else
+#if defined(__AVX__)
+    for (; k < end && (uintptr_t)(mat_j + k) % (VEC_PD * sizeof(double)); k++)
+        mat_j[k] -= mat_i[k] * div;
+    __m256d d = _mm256_set1_pd(div);
+    for (; k + UNROLL * VEC_PD <= end; k += UNROLL * VEC_PD)
+    {
+        __m256d r0 = _mm256_sub_pd(_mm256_load_pd(mat_j + k), _mm256_mul_pd(_mm256_loadu_pd(mat_i + k), d));
+        __m256d r1 = _mm256_sub_pd(_mm256_load_pd(mat_j + k + 4), _mm256_mul_pd(_mm256_loadu_pd(mat_i + k + 4), d));
+        __m256d r2 = _mm256_sub_pd(_mm256_load_pd(mat_j + k + 8), _mm256_mul_pd(_mm256_loadu_pd(mat_i + k + 8), d));
+        __m256d r3 = _mm256_sub_pd(_mm256_load_pd(mat_j + k + 12), _mm256_mul_pd(_mm256_loadu_pd(mat_i + k + 12), d));
+        _mm256_store_pd(mat_j + k, r0);
+        _mm256_store_pd(mat_j + k + 4, r1);
+        _mm256_store_pd(mat_j + k + 8, r2);
+        _mm256_store_pd(mat_j + k + 12, r3);
+    }
+    for (; k + VEC_PD <= end; k += VEC_PD)
+        _mm256_store_pd(mat_j + k, _mm256_sub_pd(_mm256_load_pd(mat_j + k), _mm256_mul_pd(_mm256_loadu_pd(mat_i + k), d)));
+#endif
+    for (; k < end; k++)
+        mat_j[k] -= mat_i[k] * div;
+#endif
+}
+
 void LU_simd(ele_t mat[N][N], int n)
 {
-    // ele_t new_mat[N][N];
-    memcpy(new_mat, mat, sizeof(ele_t) * N * N);
+    prepare(mat);
+    copy_rows(mat, n, 0, n);
 
     for (int i = 0; i < n; i++)
         for (int j = i + 1; j < n; j++)
@@ -82,18 +407,8 @@ void LU_simd(ele_t mat[N][N], int n)
             if (new_mat[i][i] == 0)
                 continue;
             ele_t div = new_mat[j][i] / new_mat[i][i];
-            float32x4_t div4 = vmovq_n_f32(div);
-            float32x4_t mat_j;
-            float32x4_t mat_i;
-            float32x4_t res;
             // cout << new_mat[j][i] << '/' << new_mat[i][i] << '=' << div << endl;
-            for (int k = i / 4 * 4; k < n; k += 4)
-            {
-                mat_j = vld1q_f32(new_mat[j] + k);
-                mat_i = vld1q_f32(new_mat[i] + k);
-                res = vmlsq_f32(mat_j, div4, mat_i);
-                vst1q_f32(new_mat[j] + k, res);
-            }
+            row_update(new_mat[j], new_mat[i], div, aligned_begin(new_mat[j], i), n);
         }
 
 #ifdef DEBUG
@@ -112,9 +427,14 @@ struct LU_data
     int th;
     pthread_mutex_t finished = PTHREAD_MUTEX_INITIALIZER;
     pthread_mutex_t startNext = PTHREAD_MUTEX_INITIALIZER;
-    ele_t (*mat)[N][N];
+    ele_t (*mat)[N];
+    ele_t (*src)[N]; // 输入矩阵，线程启动时先拷贝自己的行
     int n;
     int i, begin, nLines; // 当前行、开始消去行、结束消去行
+    int *perm;            // 选主元版本使用的行置换
+    int cand;             // 本线程负责的行中下一列的主元候选
+    double cand_v;
+    bool stop = false; // 常驻线程退出标志
 };
 
 void *subthread_LU(void *_params)
@@ -122,23 +442,14 @@ void *subthread_LU(void *_params)
     LU_data *params = (LU_data *)_params;
     int i = params->i;
     int n = params->n;
-    float32x4_t mat_j, mat_i, div4;
-    // cout << "mat_j addr: " << &mat_j << endl;
-    // cout << "mat_i addr: " << &mat_i << endl;
-    // cout << "div4 addr: " << &div4 << endl;
     for (int j = params->begin; j < params->begin + params->nLines; j++)
     {
-        if ((*params->mat)[i][i] == 0)
+        if (params->mat[i][i] == 0)
             continue;
-        ele_t div = (*params->mat)[j][i] / (*params->mat)[i][i];
-        div4 = vmovq_n_f32(div);
-        for (int k = i / 4 * 4; k < n; k += 4)
-        {
-            mat_j = vld1q_f32((*params->mat)[j] + k);
-            mat_i = vld1q_f32((*params->mat)[i] + k);
-            vst1q_f32((*params->mat)[j] + k, vmlsq_f32(mat_j, div4, mat_i));
-        }
+        ele_t div = params->mat[j][i] / params->mat[i][i];
+        row_update(params->mat[j], params->mat[i], div, aligned_begin(params->mat[j], i), n);
     }
+    return NULL;
 }
 
 // void *subthread_LU(void *_params)
@@ -167,7 +478,8 @@ void *subthread_LU(void *_params)
 
 void LU_pthread(ele_t mat[N][N], int n)
 {
-    memcpy(new_mat, mat, sizeof(ele_t) * N * N);
+    prepare(mat);
+    parallel_copy(mat, n);
     pthread_t threads[NUM_THREADS];
     LU_data attr[NUM_THREADS];
 
@@ -175,14 +487,14 @@ void LU_pthread(ele_t mat[N][N], int n)
     {
         // for (int j = i + 1; j < n; j++)
         // 从第i+1行开始遍历，步进为线程数
-        int nLines = (n - i - 1) / NUM_THREADS;
+        int nLines = (n - i - 1) / nthreads;
         // cout << "-------------------" << endl;
         if (nLines > 31)
         {
-            for (int th = 0; th < NUM_THREADS; th++)
+            for (int th = 0; th < nthreads; th++)
             {
                 attr[th].th = th;
-                attr[th].mat = &new_mat;
+                attr[th].mat = new_mat;
                 attr[th].n = n;
                 attr[th].i = i;
                 attr[th].nLines = nLines;
@@ -190,7 +502,7 @@ void LU_pthread(ele_t mat[N][N], int n)
                 // cout << "attr addr: " << &attr << endl;
                 // cout << "attr->i: " << attr.i << endl;
                 // cout << th << " creating" << endl;
-                int err = pthread_create(&threads[th], NULL, subthread_LU, (void *)&attr[th]);
+                int err = pthread_create(&threads[th], thread_attr(th), subthread_LU, (void *)&attr[th]);
 
                 // cout << "th" << th << endl;
                 // int c;
@@ -204,7 +516,7 @@ void LU_pthread(ele_t mat[N][N], int n)
             }
 
             // 算掉无法被整除的最后几行
-            for (int j = i + 1 + NUM_THREADS * ((n - i - 1) / NUM_THREADS); j < n; j++)
+            for (int j = i + 1 + nthreads * ((n - i - 1) / nthreads); j < n; j++)
             {
                 if (new_mat[i][i] == 0)
                     continue;
@@ -213,7 +525,7 @@ void LU_pthread(ele_t mat[N][N], int n)
                     new_mat[j][k] -= new_mat[i][k] * div;
             }
 
-            for (int th = 0; th < NUM_THREADS; th++)
+            for (int th = 0; th < nthreads; th++)
                 pthread_join(threads[th], NULL);
             // cout << "all finished" << endl << endl;
         }
@@ -224,18 +536,8 @@ void LU_pthread(ele_t mat[N][N], int n)
                 if (new_mat[i][i] == 0)
                     continue;
                 ele_t div = new_mat[j][i] / new_mat[i][i];
-                float32x4_t div4 = vmovq_n_f32(div);
-                float32x4_t mat_j;
-                float32x4_t mat_i;
-                float32x4_t res;
                 // cout << new_mat[j][i] << '/' << new_mat[i][i] << '=' << div << endl;
-                for (int k = i / 4 * 4; k < n; k += 4)
-                {
-                    mat_j = vld1q_f32(new_mat[j] + k);
-                    mat_i = vld1q_f32(new_mat[i] + k);
-                    res = vmlsq_f32(mat_j, div4, mat_i);
-                    vst1q_f32(new_mat[j] + k, res);
-                }
+                row_update(new_mat[j], new_mat[i], div, aligned_begin(new_mat[j], i), n);
             }
         }
     }
@@ -256,27 +558,21 @@ void *subthread_static_LU(void *_params)
     LU_data *params = (LU_data *)_params;
     int i = params->i;
     int n = params->n;
-    float32x4_t mat_j, mat_i, div4;
-    // cout << "mat_j addr: " << &mat_j << endl;
-    // cout << "mat_i addr: " << &mat_i << endl;
-    // cout << "div4 addr: " << &div4 << endl;
+    copy_rows(params->src, n, params->begin, params->begin + params->nLines);
+    pthread_mutex_unlock(&(params->finished));
     while (true)
     {
         pthread_mutex_lock(&(params->startNext));
+        if (params->stop)
+            return NULL;
         i = params->i;
         n = params->n;
         for (int j = params->begin; j < params->begin + params->nLines; j++)
         {
-            if ((*params->mat)[i][i] == 0)
+            if (params->mat[i][i] == 0)
                 continue;
-            ele_t div = (*params->mat)[j][i] / (*params->mat)[i][i];
-            div4 = vmovq_n_f32(div);
-            for (int k = i / 4 * 4; k < n; k += 4)
-            {
-                mat_j = vld1q_f32((*params->mat)[j] + k);
-                mat_i = vld1q_f32((*params->mat)[i] + k);
-                vst1q_f32((*params->mat)[j] + k, vmlsq_f32(mat_j, div4, mat_i));
-            }
+            ele_t div = params->mat[j][i] / params->mat[i][i];
+            row_update(params->mat[j], params->mat[i], div, aligned_begin(params->mat[j], i), n);
         }
         pthread_mutex_unlock(&(params->finished));
     }
@@ -284,33 +580,41 @@ void *subthread_static_LU(void *_params)
 
 void LU_static_thread(ele_t mat[N][N], int n)
 {
-    memcpy(new_mat, mat, sizeof(ele_t) * N * N);
+    prepare(mat);
     pthread_t threads[NUM_THREADS];
     LU_data attr[NUM_THREADS];
 
-    for (int th = 0; th < NUM_THREADS; th++)
+    // 线程启动后先各自拷贝一段连续行，等全部拷完再开始消去
+    for (int th = 0; th < nthreads; th++)
     {
+        attr[th].src = mat;
+        attr[th].mat = new_mat;
+        attr[th].n = n;
+        attr[th].begin = th * n / nthreads;
+        attr[th].nLines = (th + 1) * n / nthreads - attr[th].begin;
         pthread_mutex_lock(&(attr[th].startNext));
         pthread_mutex_lock(&(attr[th].finished));
-        int err = pthread_create(&threads[th], NULL, subthread_static_LU, (void *)&attr[th]);
+        int err = pthread_create(&threads[th], thread_attr(th), subthread_static_LU, (void *)&attr[th]);
         if (err)
         {
             cout << "failed to create thread[" << th << "]" << endl;
             exit(-1);
         }
     }
+    for (int th = 0; th < nthreads; th++)
+        pthread_mutex_lock(&(attr[th].finished));
 
     for (int i = 0; i < n; i++)
     {
         // for (int j = i + 1; j < n; j++)
         // 从第i+1行开始遍历，步进为线程数
-        int nLines = (n - i - 1) / NUM_THREADS;
+        int nLines = (n - i - 1) / nthreads;
         // cout << "-------------------" << endl;
 
-        for (int th = 0; th < NUM_THREADS; th++)
+        for (int th = 0; th < nthreads; th++)
         {
             attr[th].th = th;
-            attr[th].mat = &new_mat;
+            attr[th].mat = new_mat;
             attr[th].n = n;
             attr[th].i = i;
             attr[th].nLines = nLines;
@@ -319,7 +623,7 @@ void LU_static_thread(ele_t mat[N][N], int n)
         }
 
         // 算掉无法被整除的最后几行
-        for (int j = i + 1 + NUM_THREADS * ((n - i - 1) / NUM_THREADS); j < n; j++)
+        for (int j = i + 1 + nthreads * ((n - i - 1) / nthreads); j < n; j++)
         {
             if (new_mat[i][i] == 0)
                 continue;
@@ -328,11 +632,19 @@ void LU_static_thread(ele_t mat[N][N], int n)
                 new_mat[j][k] -= new_mat[i][k] * div;
         }
 
-        for (int th = 0; th < NUM_THREADS; th++)
+        for (int th = 0; th < nthreads; th++)
             pthread_mutex_lock(&(attr[th].finished));
         // cout << "all finished" << endl << endl;
     }
 
+    // 通知常驻线程退出，避免其阻塞在已失效的栈上
+    for (int th = 0; th < nthreads; th++)
+    {
+        attr[th].stop = true;
+        pthread_mutex_unlock(&(attr[th].startNext));
+        pthread_join(threads[th], NULL);
+    }
+
 #ifdef DEBUG
     for (int i = 0; i < n; i++)
     {
@@ -344,38 +656,1105 @@ void LU_static_thread(ele_t mat[N][N], int n)
 #endif
 }
 
-int main()
+// 部分选主元：换行通过 perm 延迟完成，不搬动整行数据
+void LU_pivot(ele_t mat[N][N], int n)
 {
-    ifstream data("gauss.dat", ios::in | ios::binary);
-    data.read((char *)mat, N * N * sizeof(ele_t));
-    data.close();
+    prepare(mat);
+    copy_rows(mat, n, 0, n);
+    for (int i = 0; i < n; i++)
+        perm[i] = i;
 
-    // for (int i = 0; i < N; i++)
-    // {
-    //     for (int j = 0; j < N; j++)
-    //         cout << mat[i][j] << ' ';
-    //     cout << endl;
-    // }
+    for (int i = 0; i < n; i++)
+    {
+        if (!select_pivot(new_mat, perm, i, n))
+            continue;
+        ele_t *mat_i = new_mat[perm[i]];
+        for (int j = i + 1; j < n; j++)
+        {
+            ele_t *mat_j = new_mat[perm[j]];
+            ele_t div = mat_j[i] / mat_i[i];
+            for (int k = i; k < n; k++)
+                mat_j[k] -= mat_i[k] * div;
+        }
+    }
 
-#ifndef DEBUG
-    // test(LU, "commone algo: ", mat, N);
-    if (NUM_THREADS == 1)
-        test(LU_simd, "NEON/SSE: ", mat, N);
-    // test(LU_pthread, "pthread: ", mat, N);
-    else
-        test(LU_static_thread, "static thread: ", mat, N);
-#else
+#ifdef DEBUG
+    for (int i = 0; i < n; i++)
+    {
+        for (int j = 0; j < n; j++)
+            cout << new_mat[perm[i]][j] << ' ';
+        cout << endl;
+    }
     cout << endl;
-    LU(mat, N);
-    cout << endl
-         << endl;
-    // LU_simd(mat, N);
-    // cout << endl
-    //      << endl;
-    LU_pthread(mat, N);
-    cout << endl
-         << endl;
-    LU_static_thread(mat, N);
+#endif
+}
+
+void LU_simd_pivot(ele_t mat[N][N], int n)
+{
+    prepare(mat);
+    copy_rows(mat, n, 0, n);
+    for (int i = 0; i < n; i++)
+        perm[i] = i;
+
+    for (int i = 0; i < n; i++)
+    {
+        if (!select_pivot(new_mat, perm, i, n))
+            continue;
+        ele_t *mat_i = new_mat[perm[i]];
+        for (int j = i + 1; j < n; j++)
+        {
+            ele_t *mat_j = new_mat[perm[j]];
+            row_update(mat_j, mat_i, mat_j[i] / mat_i[i], aligned_begin(mat_j, i), n);
+        }
+    }
+
+#ifdef DEBUG
+    for (int i = 0; i < n; i++)
+    {
+        for (int j = 0; j < n; j++)
+            cout << new_mat[perm[i]][j] << ' ';
+        cout << endl;
+    }
+    cout << endl;
+#endif
+}
+
+// 消去第i列的同时，记录消去后第i+1列绝对值最大的行，作为主元归约的局部结果
+inline void eliminate_rows_pivot(ele_t (*mat)[N], int *p, int i, int n, int begin, int end, int &cand, double &cand_v)
+{
+    ele_t *mat_i = mat[p[i]];
+    for (int j = begin; j < end; j++)
+    {
+        ele_t *mat_j = mat[p[j]];
+        ele_t div = mat_j[i] / mat_i[i];
+        row_update(mat_j, mat_i, div, aligned_begin(mat_j, i), n);
+        if (elim_rhs)
+            for (int r = 0; r < NRHS; r++)
+                elim_rhs[p[j]][r] -= elim_rhs[p[i]][r] * div;
+        if (i + 1 < n && fabs(mat_j[i + 1]) > cand_v)
+        {
+            cand_v = fabs(mat_j[i + 1]);
+            cand = j;
+        }
+    }
+}
+
+void *subthread_static_LU_pivot(void *_params)
+{
+    LU_data *params = (LU_data *)_params;
+    copy_rows(params->src, params->n, params->begin, params->begin + params->nLines);
+    pthread_mutex_unlock(&(params->finished));
+    while (true)
+    {
+        pthread_mutex_lock(&(params->startNext));
+        if (params->stop)
+            return NULL;
+        params->cand = -1;
+        params->cand_v = -1;
+        eliminate_rows_pivot(params->mat, params->perm, params->i, params->n,
+                             params->begin, params->begin + params->nLines, params->cand, params->cand_v);
+        pthread_mutex_unlock(&(params->finished));
+    }
+}
+
+// 主元搜索与消去融合：各线程在消去时顺带求下一列的局部最大值，主线程归约后换行
+void LU_static_thread_pivot(ele_t mat[N][N], int n)
+{
+    prepare(mat);
+    pthread_t threads[NUM_THREADS];
+    LU_data attr[NUM_THREADS];
+    for (int i = 0; i < n; i++)
+        perm[i] = i;
+
+    // 线程启动后先各自拷贝一段连续行，等全部拷完再开始消去
+    for (int th = 0; th < nthreads; th++)
+    {
+        attr[th].src = mat;
+        attr[th].mat = new_mat;
+        attr[th].n = n;
+        attr[th].begin = th * n / nthreads;
+        attr[th].nLines = (th + 1) * n / nthreads - attr[th].begin;
+        pthread_mutex_lock(&(attr[th].startNext));
+        pthread_mutex_lock(&(attr[th].finished));
+        int err = pthread_create(&threads[th], thread_attr(th), subthread_static_LU_pivot, (void *)&attr[th]);
+        if (err)
+        {
+            cout << "failed to create thread[" << th << "]" << endl;
+            exit(-1);
+        }
+    }
+    for (int th = 0; th < nthreads; th++)
+        pthread_mutex_lock(&(attr[th].finished));
+
+    bool ok = select_pivot(new_mat, perm, 0, n);
+    for (int i = 0; i < n; i++)
+    {
+        if (!ok)
+        { // 主元过小，跳过本列，串行找下一列主元
+            if (i + 1 < n)
+                ok = select_pivot(new_mat, perm, i + 1, n);
+            continue;
+        }
+        int nLines = (n - i - 1) / nthreads;
+
+        for (int th = 0; th < nthreads; th++)
+        {
+            attr[th].th = th;
+            attr[th].mat = new_mat;
+            attr[th].perm = perm;
+            attr[th].n = n;
+            attr[th].i = i;
+            attr[th].nLines = nLines;
+            attr[th].begin = i + 1 + th * nLines;
+            pthread_mutex_unlock(&(attr[th].startNext));
+        }
+
+        // 算掉无法被整除的最后几行
+        int cand = -1;
+        double cand_v = -1;
+        eliminate_rows_pivot(new_mat, perm, i, n, i + 1 + nthreads * nLines, n, cand, cand_v);
+
+        for (int th = 0; th < nthreads; th++)
+        {
+            pthread_mutex_lock(&(attr[th].finished));
+            if (attr[th].cand_v > cand_v)
+            {
+                cand_v = attr[th].cand_v;
+                cand = attr[th].cand;
+            }
+        }
+        if (cand >= 0)
+            swap(perm[i + 1], perm[cand]);
+        ok = cand_v > ZERO;
+    }
+
+    // 通知常驻线程退出，避免其阻塞在已失效的栈上
+    for (int th = 0; th < nthreads; th++)
+    {
+        attr[th].stop = true;
+        pthread_mutex_unlock(&(attr[th].startNext));
+        pthread_join(threads[th], NULL);
+    }
+
+#ifdef DEBUG
+    for (int i = 0; i < n; i++)
+    {
+        for (int j = 0; j < n; j++)
+            cout << new_mat[perm[i]][j] << ' ';
+        cout << endl;
+    }
+    cout << endl;
+#endif
+}
+
+// 二维块划分：线程排成 grid_r x grid_c，每步把剩余子矩阵按行块x列块分给各线程
+struct LU2d_data
+{
+    int th;
+    pthread_mutex_t finished = PTHREAD_MUTEX_INITIALIZER;
+    pthread_mutex_t startNext = PTHREAD_MUTEX_INITIALIZER;
+    int i;
+    int rBegin, rEnd, kBegin, kEnd; // 负责的行块、列块
+    bool stop = false;
+    ele_t pivot[N] __attribute__((aligned(64))); // 主元行在本线程列块上的私有副本
+};
+
+// 把 [begin, end) 分成 parts 块，返回第b块；除首尾外边界按 align 对齐，避免列块共享缓存行
+inline void split_range(int begin, int end, int parts, int b, int align, int &lo, int &hi)
+{
+    int len = (end - begin + parts - 1) / parts;
+    lo = b == 0 ? begin : min(end, (begin + b * len + align - 1) / align * align);
+    hi = b == parts - 1 ? end : min(end, (begin + (b + 1) * len + align - 1) / align * align);
+}
+
+void *subthread_2d_LU(void *_params)
+{
+    LU2d_data *params = (LU2d_data *)_params;
+    while (true)
+    {
+        pthread_mutex_lock(&(params->startNext));
+        if (params->stop)
+            return NULL;
+        int i = params->i, kb = params->kBegin, ke = params->kEnd;
+        ele_t *piv = params->pivot;
+        ele_t diag = new_mat[i][i];
+        if (diag != 0 && kb < ke && params->rBegin < params->rEnd)
+        {
+            // 只拷贝自己列块的那一段主元行，之后只读本线程的副本
+            memcpy(piv + kb, new_mat[i] + kb, sizeof(ele_t) * (ke - kb));
+            for (int j = params->rBegin; j < params->rEnd; j++)
+            {
+                ele_t *mat_j = new_mat[j];
+                ele_t div = mat_j[i] / diag; // 第i列本步不写，各列块读到的乘子一致
+                row_update(mat_j, piv, div, kb, ke);
+            }
+        }
+        pthread_mutex_unlock(&(params->finished));
+    }
+}
+
+void LU_grid_thread(ele_t mat[N][N], int n, int grid_r, int grid_c)
+{
+    prepare(mat);
+    parallel_copy(mat, n);
+    pthread_t threads[NUM_THREADS];
+    LU2d_data *attr = new LU2d_data[NUM_THREADS];
+    int nth = grid_r * grid_c;
+
+    for (int th = 0; th < nth; th++)
+    {
+        attr[th].th = th;
+        pthread_mutex_lock(&(attr[th].startNext));
+        pthread_mutex_lock(&(attr[th].finished));
+        int err = pthread_create(&threads[th], thread_attr(th), subthread_2d_LU, (void *)&attr[th]);
+        if (err)
+        {
+            cout << "failed to create thread[" << th << "]" << endl;
+            exit(-1);
+        }
+    }
+
+    for (int i = 0; i < n - 1; i++)
+    {
+        for (int th = 0; th < nth; th++)
+        {
+            attr[th].i = i;
+            split_range(i + 1, n, grid_r, th / grid_c, 1, attr[th].rBegin, attr[th].rEnd);
+            split_range(i + 1, n, grid_c, th % grid_c, 16, attr[th].kBegin, attr[th].kEnd);
+            pthread_mutex_unlock(&(attr[th].startNext));
+        }
+        for (int th = 0; th < nth; th++)
+            pthread_mutex_lock(&(attr[th].finished));
+    }
+
+    for (int th = 0; th < nth; th++)
+    {
+        attr[th].stop = true;
+        pthread_mutex_unlock(&(attr[th].startNext));
+        pthread_join(threads[th], NULL);
+    }
+    delete[] attr;
+
+    // 消去过程中没有写第i列，最后统一把下三角清零
+    for (int j = 1; j < n; j++)
+        for (int i = 0; i < j && i < n; i++)
+            if (new_mat[i][i] != 0)
+                new_mat[j][i] = 0;
+
+#ifdef DEBUG
+    for (int i = 0; i < n; i++)
+    {
+        for (int j = 0; j < n; j++)
+            cout << new_mat[i][j] << ' ';
+        cout << endl;
+    }
+    cout << endl;
+#endif
+}
+
+// 行数不少于列数、尽量接近正方形的线程网格
+inline int grid_rows(int nth)
+{
+    int r = (int)sqrt((double)nth);
+    while (nth % r)
+        r--;
+    return nth / r;
+}
+
+void LU_row_thread(ele_t mat[N][N], int n)
+{
+    LU_grid_thread(mat, n, nthreads, 1);
+}
+
+void LU_col_thread(ele_t mat[N][N], int n)
+{
+    LU_grid_thread(mat, n, 1, nthreads);
+}
+
+void LU_2d_thread(ele_t mat[N][N], int n)
+{
+    LU_grid_thread(mat, n, grid_rows(nthreads), nthreads / grid_rows(nthreads));
+}
+
+// 流水线消去：行按线程循环划分，第k+1行在第k步被其所属线程最先消去并立即发布，
+// 其他线程不必等第k步全部结束就能开始第k+1步，每步不再有全体同步
+atomic<int> row_ready[N]; // 行k已完成前k步消去，可作为主元行
+
+struct pipeline_data
+{
+    int th, n;
+    ele_t (*src)[N];
+};
+
+void *subthread_pipeline_LU(void *_params)
+{
+    pipeline_data *params = (pipeline_data *)_params;
+    int th = params->th, n = params->n;
+    // 先拷贝自己负责的行，第0行拷完即可发布
+    copy_rows(params->src, n, th, n, nthreads);
+    if (th == 0)
+        row_ready[0].store(1, memory_order_release);
+    for (int i = 0; i < n - 1; i++)
+    {
+        int first = i + 1 + ((th - (i + 1)) % nthreads + nthreads) % nthreads;
+        if (first >= n)
+            break;
+        while (!row_ready[i].load(memory_order_acquire))
+            sched_yield();
+        ele_t *mat_i = new_mat[i];
+        if (mat_i[i] != 0)
+            for (int j = first; j < n; j += nthreads)
+            {
+                ele_t *mat_j = new_mat[j];
+                ele_t div = mat_j[i] / mat_i[i];
+                row_update(mat_j, mat_i, div, aligned_begin(mat_j, i), n);
+                if (j == i + 1)
+                    row_ready[i + 1].store(1, memory_order_release);
+            }
+        else if (first == i + 1)
+            row_ready[i + 1].store(1, memory_order_release);
+    }
+    return NULL;
+}
+
+void LU_pipeline_thread(ele_t mat[N][N], int n)
+{
+    prepare(mat);
+    pthread_t threads[NUM_THREADS];
+    pipeline_data attr[NUM_THREADS];
+
+    for (int i = 0; i < n; i++)
+        row_ready[i].store(0, memory_order_relaxed);
+
+    for (int th = 0; th < nthreads; th++)
+    {
+        attr[th].th = th;
+        attr[th].n = n;
+        attr[th].src = mat;
+        int err = pthread_create(&threads[th], thread_attr(th), subthread_pipeline_LU, (void *)&attr[th]);
+        if (err)
+        {
+            cout << "failed to create thread[" << th << "]" << endl;
+            exit(-1);
+        }
+    }
+    for (int th = 0; th < nthreads; th++)
+        pthread_join(threads[th], NULL);
+
+#ifdef DEBUG
+    for (int i = 0; i < n; i++)
+    {
+        for (int j = 0; j < n; j++)
+            cout << new_mat[i][j] << ' ';
+        cout << endl;
+    }
+    cout << endl;
+#endif
+}
+
+// 用第i行消去第j行，OpenMP 与并行算法版本共用
+inline void eliminate_row(ele_t *mat_j, const ele_t *mat_i, int i, int n)
+{
+    row_update(mat_j, mat_i, mat_j[i] / mat_i[i], aligned_begin(mat_j, i), n);
+}
+
+#ifdef _OPENMP
+// 调度方式由 omp_set_schedule 或环境变量 OMP_SCHEDULE 决定（schedule(runtime)）
+void LU_omp(ele_t mat[N][N], int n)
+{
+    prepare(mat);
+#pragma omp parallel num_threads(nthreads)
+    {
+        // 按静态划分各自拷贝，页面分配到之后多数时候负责它的线程
+#pragma omp for schedule(static)
+        for (int j = 0; j < n; j++)
+            copy_rows(mat, n, j, j + 1);
+        for (int i = 0; i < n; i++)
+        {
+            if (new_mat[i][i] == 0) // omp for 结束处有隐式屏障，各线程看到的主元相同
+                continue;
+#pragma omp for schedule(runtime)
+            for (int j = i + 1; j < n; j++)
+                eliminate_row(new_mat[j], new_mat[i], i, n);
+        }
+    }
+
+#ifdef DEBUG
+    for (int i = 0; i < n; i++)
+    {
+        for (int j = 0; j < n; j++)
+            cout << new_mat[i][j] << ' ';
+        cout << endl;
+    }
+    cout << endl;
+#endif
+}
+#endif
+
+#ifdef PSTL
+// 线程数由并行算法的实现决定（libstdc++ 下为 TBB 的默认线程池），不受 nthreads 控制
+void LU_pstl(ele_t mat[N][N], int n)
+{
+    prepare(mat);
+    static int idx[N];
+    iota(idx, idx + n, 0);
+    for_each(execution::par_unseq, idx, idx + n, [=](int j)
+             { copy_rows(mat, n, j, j + 1); });
+    for (int i = 0; i < n; i++)
+    {
+        if (new_mat[i][i] == 0)
+            continue;
+        for_each(execution::par_unseq, idx + i + 1, idx + n, [=](int j)
+                 { eliminate_row(new_mat[j], new_mat[i], i, n); });
+    }
+
+#ifdef DEBUG
+    for (int i = 0; i < n; i++)
+    {
+        for (int j = 0; j < n; j++)
+            cout << new_mat[i][j] << ' ';
+        cout << endl;
+    }
+    cout << endl;
+#endif
+}
+#endif
+
+// 按名称选出后端对应的内核，未编译进来的返回 NULL；记录和输出时以后端名作为内核名：
+//   pthread  常驻线程版本（serial 为真且 nthreads 为1时为单线程SIMD版本；扩展性扫描传 false，各线程数用同一个内核）
+//   omp_static / omp_dynamic / omp_guided  OpenMP，对应的调度方式
+//   pstl     std::execution::par_unseq
+void (*backend_kernel(const string &name, bool serial = true))(ele_t[N][N], int)
+{
+    if (name == "pthread")
+        return serial && nthreads == 1 ? LU_simd : LU_static_thread;
+#ifdef _OPENMP
+    if (name == "omp_static" || name == "omp_dynamic" || name == "omp_guided")
+    {
+        omp_set_schedule(name == "omp_static" ? omp_sched_static : name == "omp_dynamic" ? omp_sched_dynamic
+                                                                                         : omp_sched_guided,
+                         0);
+        return LU_omp;
+    }
+#endif
+#ifdef PSTL
+    if (name == "pstl")
+        return LU_pstl;
+#endif
+    return NULL;
+}
+
+// 逗号分隔的列表拆成各项
+vector<string> split_list(const char *list)
+{
+    vector<string> items;
+    string s = list;
+    for (size_t pos = 0; pos <= s.size();)
+    {
+        size_t end = s.find(',', pos);
+        if (end == string::npos)
+            end = s.size();
+        items.push_back(s.substr(pos, end - pos));
+        pos = end + 1;
+    }
+    return items;
+}
+
+// 测试环境变量 BACKEND 中以逗号分隔的各后端，"后端名,时间," 依次输出到同一行，未编译进来的后端时间为 "-"
+void test_backends(const char *backend, ele_t mat[N][N], int n)
+{
+    for (const string &name : split_list(backend))
+    {
+        void (*func)(ele_t[N][N], int) = backend_kernel(name);
+        cout << name << ',';
+        if (func)
+            test(func, name.c_str(), mat, n);
+        else
+            cout << "-,";
+    }
+}
+
+// 扩展性扫描（见 scaling.h），BACKEND 中的每个后端（默认 pthread）各扫描一遍，弱扩展按 n^3 的工作量
+void scale_backends(const char *backend, ele_t mat[N][N])
+{
+    for (const string &name : split_list(backend))
+    {
+        if (!backend_kernel(name))
+        {
+            cout << name << ": not compiled in" << endl;
+            continue;
+        }
+        scale_sweep("gauss", name.c_str(), scale_list("SCALE_N", {N}), N, 3, NUM_THREADS, [&](int n, int p)
+                    {
+                        nthreads = p;
+                        void (*func)(ele_t[N][N], int) = backend_kernel(name, false); // 1线程的基准也用同一个内核
+                        return bench([&]
+                                     { func(mat, n); },
+                                     preserve_input); });
+    }
+    nthreads = NUM_THREADS;
+}
+
+// 每种类型一份工作矩阵，第一次用到时分配
+template <typename T>
+row_t<T> *typed_mat()
+{
+    static row_t<T> *buf = new T[N][N];
+    return buf;
+}
+
+template <typename T>
+void load_typed(row_t<T> *a, ele_t mat[N][N], int n)
+{
+    for (int i = 0; i < n; i++)
+        for (int j = 0; j < n; j++)
+            a[i][j] = (T)mat[i][j];
+}
+
+// 以T类型原地消去，p不为空时部分选主元
+template <typename T>
+void eliminate(row_t<T> *a, int *p, int n)
+{
+    typedef typename acc_of<T>::type acc_t;
+    if (p)
+        for (int i = 0; i < n; i++)
+            p[i] = i;
+
+    for (int i = 0; i < n; i++)
+    {
+        if (p && !select_pivot(a, p, i, n))
+            continue;
+        T *a_i = a[p ? p[i] : i];
+        acc_t piv = a_i[i];
+        if (piv == 0)
+            continue;
+        for (int j = i + 1; j < n; j++)
+        {
+            T *a_j = a[p ? p[j] : j];
+            acc_t div = (acc_t)a_j[i] / piv;
+            for (int k = i; k < n; k++)
+                a_j[k] = (T)((acc_t)a_j[k] - (acc_t)a_i[k] * div);
+        }
+    }
+}
+
+int typed_perm[N];
+
+// 以T类型存储的串行消去，用来比较不同精度的速度和误差
+template <typename T, bool PIVOT = false>
+void LU_typed(ele_t mat[N][N], int n)
+{
+    row_t<T> *a = typed_mat<T>();
+    load_typed(a, mat, n);
+    eliminate(a, PIVOT ? typed_perm : NULL, n);
+}
+
+// 上三角部分相对长双精度参考结果的最大相对误差，p不为空时与选主元的参考结果比较
+template <typename T>
+double elim_error(row_t<T> *u, const int *p, ele_t mat[N][N], int n)
+{
+    static row_t<long double> *ref[2];
+    static int ref_perm[N], ref_n[2];
+    int mode = p != NULL;
+    if (ref_n[mode] != n)
+    {
+        if (!ref[mode])
+            ref[mode] = new long double[N][N];
+        load_typed(ref[mode], mat, n);
+        eliminate(ref[mode], mode ? ref_perm : NULL, n);
+        ref_n[mode] = n;
+    }
+    long double max_ref = 0, max_diff = 0;
+    for (int i = 0; i < n; i++)
+    {
+        long double *r = ref[mode][mode ? ref_perm[i] : i];
+        T *v = u[mode ? p[i] : i];
+        for (int j = i; j < n; j++)
+        {
+            max_ref = max(max_ref, fabsl(r[j]));
+            max_diff = max(max_diff, fabsl((long double)(typename acc_of<T>::type)v[j] - r[j]));
+        }
+    }
+    return max_ref == 0 ? 0 : (double)(max_diff / max_ref);
+}
+
+// 部分选主元的LU分解，L（单位下三角）存在各物理行的前半部分
+template <typename T>
+void LU_factor(row_t<T> *a, int *p, int n)
+{
+    typedef typename acc_of<T>::type acc_t;
+    for (int i = 0; i < n; i++)
+        p[i] = i;
+    for (int i = 0; i < n; i++)
+    {
+        if (!select_pivot(a, p, i, n))
+            continue;
+        T *a_i = a[p[i]];
+        acc_t piv = a_i[i];
+        for (int j = i + 1; j < n; j++)
+        {
+            T *a_j = a[p[j]];
+            acc_t div = (acc_t)a_j[i] / piv;
+            a_j[i] = (T)div;
+            for (int k = i + 1; k < n; k++)
+                a_j[k] = (T)((acc_t)a_j[k] - (acc_t)a_i[k] * div);
+        }
+    }
+}
+
+// 用LU因子求解 LUx=Pb，x以V精度运算
+template <typename T, typename V>
+void LU_substitute(row_t<T> *a, const int *p, V *x, int n)
+{
+    static V y[N];
+    for (int i = 0; i < n; i++)
+    {
+        V s = x[p[i]];
+        for (int k = 0; k < i; k++)
+            s -= (V)a[p[i]][k] * y[k];
+        y[i] = s;
+    }
+    for (int i = n - 1; i >= 0; i--)
+    {
+        V s = y[i];
+        for (int k = i + 1; k < n; k++)
+            s -= (V)a[p[i]][k] * x[k];
+        x[i] = s / (V)a[p[i]][i];
+    }
+}
+
+double rhs[N], sol[N], res[N];
+int refine_iters;
+
+// b = A * (1,1,...,1)，精确解为全1
+void make_rhs(ele_t mat[N][N], int n)
+{
+    for (int i = 0; i < n; i++)
+    {
+        double s = 0;
+        for (int j = 0; j < n; j++)
+            s += (double)mat[i][j];
+        rhs[i] = s;
+    }
+}
+
+// 残差 res = b - Ax（double），返回归一化后向误差 ||r|| / (||A|| ||x|| + ||b||)
+double residual(ele_t mat[N][N], int n)
+{
+    double a_norm = 0, x_norm = 0, b_norm = 0, r_norm = 0;
+    for (int i = 0; i < n; i++)
+    {
+        double s = rhs[i], row_sum = 0;
+        for (int j = 0; j < n; j++)
+        {
+            s -= (double)mat[i][j] * sol[j];
+            row_sum += fabs((double)mat[i][j]);
+        }
+        res[i] = s;
+        a_norm = max(a_norm, row_sum);
+        x_norm = max(x_norm, fabs(sol[i]));
+        b_norm = max(b_norm, fabs(rhs[i]));
+        r_norm = max(r_norm, fabs(s));
+    }
+    return r_norm / (a_norm * x_norm + b_norm);
+}
+
+// 直接以T精度分解并求解
+template <typename T>
+void solve_direct(ele_t mat[N][N], int n)
+{
+    typedef typename acc_of<T>::type acc_t;
+    static acc_t x[N];
+    row_t<T> *a = typed_mat<T>();
+    load_typed(a, mat, n);
+    LU_factor(a, typed_perm, n);
+    for (int i = 0; i < n; i++)
+        x[i] = (acc_t)rhs[i];
+    LU_substitute(a, typed_perm, x, n);
+    for (int i = 0; i < n; i++)
+        sol[i] = (double)x[i];
+    refine_iters = 0;
+}
+
+// 混合精度：float分解（O(n^3)），double残差迭代修正（每次O(n^2)）
+void solve_mixed(ele_t mat[N][N], int n)
+{
+    static float d[N];
+    row_t<float> *a = typed_mat<float>();
+    load_typed(a, mat, n);
+    LU_factor(a, typed_perm, n);
+    for (int i = 0; i < n; i++)
+        d[i] = (float)rhs[i];
+    LU_substitute(a, typed_perm, d, n);
+    for (int i = 0; i < n; i++)
+        sol[i] = d[i];
+
+    for (refine_iters = 0; refine_iters < MAX_REFINE; refine_iters++)
+    {
+        if (residual(mat, n) <= n * DBL_EPSILON)
+            break;
+        for (int i = 0; i < n; i++)
+            d[i] = (float)res[i];
+        LU_substitute(a, typed_perm, d, n);
+        for (int i = 0; i < n; i++)
+            sol[i] += d[i];
+    }
+}
+
+// 计时并输出 时间,后向误差,与精确解的最大误差,迭代次数,
+void test_solve(void (*func)(ele_t[N][N], int), const char *msg, ele_t mat[N][N], int len)
+{
+    test(func, msg, mat, len);
+    double ferr = 0;
+    for (int i = 0; i < len; i++)
+        ferr = max(ferr, fabs(sol[i] - 1));
+    cout << residual(mat, len) << ',' << ferr << ',' << refine_iters << ',';
+}
+
+double b_in[N][NRHS], x_true[N][NRHS]; // 完整求解的右端项与精确解
+ele_t x_buf[N][NRHS] __attribute__((aligned(64))); // 解，按逻辑行存放
+double solve_berr, solve_ferr, log_det; // 后向误差、与精确解的最大相对误差、log10|det(A)|
+int det_sign;
+
+// 第r个精确解 x_j = 1 + r*j/n（第0个为全1，与 make_rhs 一致），b = A x 以 double 计算
+void make_rhs_batch(ele_t mat[N][N], int n)
+{
+    for (int j = 0; j < n; j++)
+        for (int r = 0; r < NRHS; r++)
+            x_true[j][r] = 1 + (double)r * j / n;
+    for (int i = 0; i < n; i++)
+    {
+        double s[NRHS] = {0};
+        for (int j = 0; j < n; j++)
+            for (int r = 0; r < NRHS; r++)
+                s[r] += (double)mat[i][j] * x_true[j][r];
+        for (int r = 0; r < NRHS; r++)
+            b_in[i][r] = s[r];
+    }
+}
+
+// 第一阶段：选主元消去，右端项随之做同样的行变换，结束后 new_mat/perm 为 U，rhs_buf 为 L^-1 P b
+void solve_factor(ele_t mat[N][N], int n)
+{
+    for (int i = 0; i < n; i++)
+        for (int r = 0; r < NRHS; r++)
+            rhs_buf[i][r] = (ele_t)b_in[i][r];
+    elim_rhs = rhs_buf;
+    LU_static_thread_pivot(mat, n);
+    elim_rhs = NULL;
+}
+
+struct backsub_data
+{
+    pthread_mutex_t finished = PTHREAD_MUTEX_INITIALIZER;
+    pthread_mutex_t startNext = PTHREAD_MUTEX_INITIALIZER;
+    int ib, ie;     // 本步已解出的块 [ib, ie)
+    int begin, end; // 本线程负责更新的行
+    bool stop = false;
+};
+
+// x[begin, end) -= U[begin, end)[ib, ie) * x[ib, ie)，每行对 NRHS 个右端项一起更新
+inline void backsub_update(int begin, int end, int ib, int ie)
+{
+    for (int j = begin; j < end; j++)
+    {
+        const ele_t *u = new_mat[perm[j]];
+        ele_t acc[NRHS] = {0};
+        for (int k = ib; k < ie; k++)
+            for (int r = 0; r < NRHS; r++)
+                acc[r] += u[k] * x_buf[k][r];
+        for (int r = 0; r < NRHS; r++)
+            x_buf[j][r] -= acc[r];
+    }
+}
+
+void *subthread_backsub(void *_params)
+{
+    backsub_data *params = (backsub_data *)_params;
+    while (true)
+    {
+        pthread_mutex_lock(&(params->startNext));
+        if (params->stop)
+            return NULL;
+        backsub_update(params->begin, params->end, params->ib, params->ie);
+        pthread_mutex_unlock(&(params->finished));
+    }
+}
+
+// 第二阶段：多右端项的分块回代 Ux = y。从下往上每次 SOLVE_BLOCK 行：
+// 主线程解对角块，各常驻线程再用解出的这一块更新上方各自的连续行，每块只同步一次
+// 矩阵参数只为符合 test 的函数类型，实际只用 solve_factor 留下的 LU 和右端项
+void solve_backward(ele_t[N][N], int n)
+{
+    for (int i = 0; i < n; i++)
+        for (int r = 0; r < NRHS; r++)
+            x_buf[i][r] = rhs_buf[perm[i]][r];
+
+    pthread_t threads[NUM_THREADS];
+    backsub_data attr[NUM_THREADS];
+    for (int th = 0; th < nthreads; th++)
+    {
+        pthread_mutex_lock(&(attr[th].startNext));
+        pthread_mutex_lock(&(attr[th].finished));
+        int err = pthread_create(&threads[th], thread_attr(th), subthread_backsub, (void *)&attr[th]);
+        if (err)
+        {
+            cout << "failed to create thread[" << th << "]" << endl;
+            exit(-1);
+        }
+    }
+
+    for (int ie = n, ib; ie > 0; ie = ib)
+    {
+        ib = max(0, ie - SOLVE_BLOCK);
+        for (int i = ie - 1; i >= ib; i--)
+        {
+            const ele_t *u = new_mat[perm[i]];
+            for (int k = i + 1; k < ie; k++)
+                for (int r = 0; r < NRHS; r++)
+                    x_buf[i][r] -= u[k] * x_buf[k][r];
+            for (int r = 0; r < NRHS; r++)
+                x_buf[i][r] /= u[i];
+        }
+        if (ib == 0)
+            break;
+        for (int th = 0; th < nthreads; th++)
+        {
+            attr[th].ib = ib;
+            attr[th].ie = ie;
+            attr[th].begin = th * ib / nthreads;
+            attr[th].end = (th + 1) * ib / nthreads;
+            pthread_mutex_unlock(&(attr[th].startNext));
+        }
+        for (int th = 0; th < nthreads; th++)
+            pthread_mutex_lock(&(attr[th].finished));
+    }
+
+    for (int th = 0; th < nthreads; th++)
+    {
+        attr[th].stop = true;
+        pthread_mutex_unlock(&(attr[th].startNext));
+        pthread_join(threads[th], NULL);
+    }
+}
+
+// 第三阶段：各右端项的后向误差 ||b - Ax|| / (||A|| ||x|| + ||b||) 取最大（double），
+// 与精确解的最大相对误差，以及由 U 的对角元和置换的奇偶性得到的行列式
+void solve_check(ele_t mat[N][N], int n)
+{
+    double a_norm = 0, x_norm[NRHS] = {0}, b_norm[NRHS] = {0}, r_norm[NRHS] = {0}, e_norm[NRHS] = {0}, t_norm[NRHS] = {0};
+    for (int i = 0; i < n; i++)
+    {
+        double s[NRHS], row_sum = 0;
+        for (int r = 0; r < NRHS; r++)
+            s[r] = b_in[i][r];
+        for (int j = 0; j < n; j++)
+        {
+            double a = mat[i][j];
+            row_sum += fabs(a);
+            for (int r = 0; r < NRHS; r++)
+                s[r] -= a * x_buf[j][r];
+        }
+        a_norm = max(a_norm, row_sum);
+        for (int r = 0; r < NRHS; r++)
+        {
+            r_norm[r] = max(r_norm[r], fabs(s[r]));
+            x_norm[r] = max(x_norm[r], fabs((double)x_buf[i][r]));
+            b_norm[r] = max(b_norm[r], fabs(b_in[i][r]));
+            e_norm[r] = max(e_norm[r], fabs(x_buf[i][r] - x_true[i][r]));
+            t_norm[r] = max(t_norm[r], fabs(x_true[i][r]));
+        }
+    }
+    solve_berr = solve_ferr = 0;
+    for (int r = 0; r < NRHS; r++)
+    {
+        solve_berr = max(solve_berr, r_norm[r] / (a_norm * x_norm[r] + b_norm[r]));
+        solve_ferr = max(solve_ferr, e_norm[r] / t_norm[r]);
+    }
+
+    // 置换每个长为 L 的环贡献 L-1 次对换
+    static bool seen[N];
+    det_sign = 1;
+    log_det = 0;
+    for (int i = 0; i < n; i++)
+        seen[i] = false;
+    for (int i = 0; i < n; i++)
+    {
+        double d = new_mat[perm[i]][i];
+        if (d < 0)
+            det_sign = -det_sign;
+        log_det += log10(fabs(d));
+        if (seen[i])
+            continue;
+        for (int j = i; !seen[j]; j = perm[j])
+        {
+            seen[j] = true;
+            if (j != i)
+                det_sign = -det_sign;
+        }
+    }
+}
+
+// 依次计时三个阶段，输出 消去,回代,检查,后向误差,与精确解的误差,det符号,log10|det|,
+void test_linsolve(ele_t mat[N][N], int n)
+{
+    make_rhs_batch(mat, n);
+    double len = n;
+    test(solve_factor, "solve factor: ", mat, n, 2.0 / 3 * len * len * len + len * len * NRHS);
+    test(solve_backward, "solve backward: ", mat, n, len * len * NRHS);
+    test(solve_check, "solve check: ", mat, n, 2 * len * len * NRHS);
+    cout << solve_berr << ',' << solve_ferr << ',' << det_sign << ',' << log_det << ',';
+}
+
+// 映射输入文件，不再整体读入：各内核的 copy_rows 由负责该行的线程直接从映射拷到工作矩阵，
+// 只有被访问的页才从页缓存读入。原地消去要写输入，用 MAP_PRIVATE 写时复制，不会改动文件
+// 文件头的阶数或文件大小与编译时的 N 不符时报错退出（行长不同会读到错位的行），见 gauss_dat.h
+// gauss.dat 总是 float，ele_t 为 double 时展宽到匿名内存
+ele_t (*load_input(const char *path))[N]
+{
+    size_t count = (size_t)N * N, bytes = count * sizeof(ele_t);
+    size_t file_bytes = sizeof(gauss_header) + count * sizeof(float);
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    gauss_header h;
+    if (fd < 0 || fstat(fd, &st) != 0)
+    {
+        perror(path);
+        exit(-1);
+    }
+    if (pread(fd, &h, sizeof(h), 0) != sizeof(h) || !gauss_header_ok(h, st.st_size, N))
+    {
+        cout << path << " is not a " << N << "x" << N << " matrix, generate it with ./datagen -n " << N << endl;
+        exit(-1);
+    }
+    int prot = preserve_input || sizeof(ele_t) != sizeof(float) ? PROT_READ : PROT_READ | PROT_WRITE;
+    char *file = (char *)mmap(NULL, file_bytes, prot, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (file == MAP_FAILED)
+    {
+        perror("mmap");
+        exit(-1);
+    }
+    float *data = (float *)(file + sizeof(gauss_header));
+    if (sizeof(ele_t) == sizeof(float))
+    {
+        madvise(file, file_bytes, MADV_WILLNEED); // 提前异步读入页缓存
+        if (!preserve_input)
+            place_memory(data, bytes); // 原地消去时写入产生的私有页按策略分配
+        return (ele_t(*)[N])data;
+    }
+    void *p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED)
+    {
+        perror("mmap");
+        exit(-1);
+    }
+    place_memory(p, bytes); // 在写入（首次访问）前设置内存策略
+    for (size_t k = 0; k < count; k++)
+        ((ele_t *)p)[k] = data[k];
+    munmap(file, file_bytes);
+    return (ele_t(*)[N])p;
+}
+
+int main()
+{
+    place_memory(new_buf, sizeof(new_buf));
+    mat = load_input("gauss.dat");
+
+    // for (int i = 0; i < N; i++)
+    // {
+    //     for (int j = 0; j < N; j++)
+    //         cout << mat[i][j] << ' ';
+    //     cout << endl;
+    // }
+
+#if !defined(DEBUG) && !defined(IN_PLACE) // 原地消去会覆盖输入，不能重复测试
+    if (getenv("SCALE_THREADS"))
+    {
+        scale_backends(getenv("BACKEND") ? getenv("BACKEND") : "pthread", mat);
+        return 0;
+    }
+#endif
+#ifndef DEBUG
+    // test(LU, "commone algo: ", mat, N);
+    if (getenv("BACKEND"))
+        test_backends(getenv("BACKEND"), mat, N);
+    else if (nthreads == 1)
+        test(LU_simd, "NEON/SSE: ", mat, N);
+    // test(LU_pthread, "pthread: ", mat, N);
+    else
+        test(LU_static_thread, "static thread: ", mat, N);
+    report_placement(new_mat, sizeof(new_buf), nthreads);
+#ifdef IN_PLACE
+    return 0; // 输入已被覆盖
+#endif
+#ifdef CHECK
+    cout << elim_error(new_mat, NULL, mat, N) << ',';
+    if (nthreads == 1)
+        test(LU_simd_pivot, "NEON/SSE pivot: ", mat, N);
+    else
+        test(LU_static_thread_pivot, "static thread pivot: ", mat, N);
+    cout << elim_error(new_mat, perm, mat, N) << ',';
+    test(LU_typed<double>, "double: ", mat, N);
+    cout << elim_error(typed_mat<double>(), NULL, mat, N) << ',';
+    test(LU_typed<double, true>, "double pivot: ", mat, N);
+    cout << elim_error(typed_mat<double>(), typed_perm, mat, N) << ',';
+    test(LU_typed<bf16_t>, "bf16: ", mat, N);
+    cout << elim_error(typed_mat<bf16_t>(), NULL, mat, N) << ',';
+#ifdef __FLT16_MAX__
+    test(LU_typed<fp16_t>, "fp16: ", mat, N);
+    cout << elim_error(typed_mat<fp16_t>(), NULL, mat, N) << ',';
+#endif
+#endif
+#ifdef PARTITION
+    test(LU_row_thread, "row partition: ", mat, N);
+    test(LU_col_thread, "column partition: ", mat, N);
+    test(LU_2d_thread, "2D partition: ", mat, N);
+#ifdef CHECK
+    cout << elim_error(new_mat, NULL, mat, N) << ',';
+#endif
+#endif
+#ifdef PIPELINE
+    test(LU_pipeline_thread, "pipeline: ", mat, N);
+#ifdef CHECK
+    cout << elim_error(new_mat, NULL, mat, N) << ',';
+#endif
+#endif
+#ifdef SOLVE
+    make_rhs(mat, N);
+    test_solve(solve_direct<float>, "float solve: ", mat, N);
+    test_solve(solve_direct<double>, "double solve: ", mat, N);
+    test_solve(solve_mixed, "mixed solve: ", mat, N);
+    test_linsolve(mat, N);
+#endif
+#else
+    cout << endl;
+    LU(mat, N);
+    cout << endl
+         << endl;
+    // LU_simd(mat, N);
+    // cout << endl
+    //      << endl;
+    LU_pthread(mat, N);
+    cout << endl
+         << endl;
+    LU_static_thread(mat, N);
+    cout << endl
+         << endl;
+    LU_pivot(mat, N);
+    cout << endl
+         << endl;
+    LU_static_thread_pivot(mat, N);
+#ifdef _OPENMP
+    cout << endl
+         << endl;
+    LU_omp(mat, N);
+#endif
+#ifdef PSTL
+    cout << endl
+         << endl;
+    LU_pstl(mat, N);
+#endif
 #endif
     return 0;
 }
@@ -0,0 +1,36 @@
+// gauss.dat 的文件格式，datagen.cpp、gauss.cpp、gauss_mpi.cpp 共用
+// 64 字节的文件头之后为 n*n 个 float，按行存放，行长为 n；
+// 文件头占满一个缓存行，数据部分与页对齐的映射起点相差64字节，行首对齐与以前相同
+#ifndef GAUSS_DAT_H
+#define GAUSS_DAT_H
+
+#include <string.h>
+#include <sys/types.h>
+
+struct gauss_header
+{
+    char magic[4];  // "GDAT"
+    int n;          // 矩阵阶数
+    int elem_size;  // 元素字节数，目前总是 sizeof(float)
+    char pad[52];
+};
+static_assert(sizeof(gauss_header) == 64, "gauss_header must fill one cache line");
+
+inline gauss_header make_gauss_header(int n)
+{
+    gauss_header h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, "GDAT", 4);
+    h.n = n;
+    h.elem_size = sizeof(float);
+    return h;
+}
+
+// 文件头与期望的阶数一致且文件大小恰好为 文件头 + n*n 个 float 时为真
+inline bool gauss_header_ok(const gauss_header &h, off_t file_size, int n)
+{
+    return !memcmp(h.magic, "GDAT", 4) && h.n == n && h.elem_size == (int)sizeof(float) &&
+           (size_t)file_size == sizeof(gauss_header) + (size_t)n * n * sizeof(float);
+}
+
+#endif
@@ -0,0 +1,253 @@
+#include <mpi.h>
+#include <pthread.h>
+#include <iostream>
+#include <fstream>
+#include <cmath>
+#include <string.h>
+#include <stdlib.h>
+
+#ifdef __ARM_NEON
+#include <arm_neon.h>
+#endif
+
+#ifdef __amd64__
+#include <immintrin.h>
+#include "NEON_2_SSE.h"
+#define USE_SSE4
+#endif
+
+#include "affinity.h"
+#include "gauss_dat.h"
+
+// 编译运行：mpicxx -O3 -march=native -pthread gauss_mpi.cpp -o gauss_mpi
+//          mpirun -np 4 ./gauss_mpi [n]
+#ifndef N
+#define N 4096 // 默认规模，可由命令行参数覆盖
+#endif
+#ifndef NUM_THREADS
+#define NUM_THREADS 1 // 每个进程的线程数，大于1即为 MPI+pthread 混合模式
+#endif
+#ifndef BLOCK
+#define BLOCK 4 // 块循环划分的块大小（行）
+#endif
+#define ele_t float
+// #define CHECK // 输出上三角绝对值之和，用于比较不同进程数的结果
+
+using namespace std;
+
+int rank_id, nprocs, n;
+int nthreads = NUM_THREADS; // 实际每进程线程数，MPI 不支持 FUNNELED 时退回1
+int nLocal;               // 本进程拥有的行数
+ele_t *local;             // 本进程的行，按全局行号递增连续存放，行长n
+ele_t *pivot_buf[2];      // 主元行双缓冲：当前步使用一个，另一个接收下一步的主元行
+
+// 块循环划分：全局第r行属于 (r / BLOCK) % nprocs 号进程
+inline int owner(int r)
+{
+    return r / BLOCK % nprocs;
+}
+
+inline int local_index(int r)
+{
+    return r / (BLOCK * nprocs) * BLOCK + r % BLOCK;
+}
+
+inline int global_index(int l)
+{
+    return l / BLOCK * BLOCK * nprocs + rank_id * BLOCK + l % BLOCK;
+}
+
+inline ele_t *local_row(int l)
+{
+    return local + (size_t)l * n;
+}
+
+// 用主元行 mat_i 消去本地第 [begin, end) 行
+void eliminate_local(const ele_t *mat_i, int i, int begin, int end)
+{
+    float32x4_t div4;
+    for (int l = begin; l < end; l++)
+    {
+        ele_t *mat_j = local_row(l);
+        ele_t div = mat_j[i] / mat_i[i];
+        div4 = vmovq_n_f32(div);
+        int k = i;
+        for (; k + 4 <= n; k += 4)
+            vst1q_f32(mat_j + k, vmlsq_f32(vld1q_f32(mat_j + k), div4, vld1q_f32(mat_i + k)));
+        for (; k < n; k++)
+            mat_j[k] -= mat_i[k] * div;
+    }
+}
+
+struct LU_data
+{
+    int th;
+    pthread_mutex_t finished = PTHREAD_MUTEX_INITIALIZER;
+    pthread_mutex_t startNext = PTHREAD_MUTEX_INITIALIZER;
+    const ele_t *mat_i;
+    int i, begin, nLines;
+    bool stop = false;
+};
+
+void *subthread_LU(void *_params)
+{
+    LU_data *params = (LU_data *)_params;
+    while (true)
+    {
+        pthread_mutex_lock(&(params->startNext));
+        if (params->stop)
+            return NULL;
+        eliminate_local(params->mat_i, params->i, params->begin, params->begin + params->nLines);
+        pthread_mutex_unlock(&(params->finished));
+    }
+}
+
+pthread_t threads[NUM_THREADS];
+LU_data attr[NUM_THREADS];
+
+// 本地行 [begin, end) 由主线程和 nthreads-1 个常驻线程分担，只有主线程调用MPI
+void eliminate_threads(const ele_t *mat_i, int i, int begin, int end)
+{
+    int nLines = (end - begin) / nthreads;
+    if (nthreads == 1 || nLines < 8)
+    {
+        eliminate_local(mat_i, i, begin, end);
+        return;
+    }
+    for (int th = 1; th < nthreads; th++)
+    {
+        attr[th].mat_i = mat_i;
+        attr[th].i = i;
+        attr[th].begin = begin + (th - 1) * nLines;
+        attr[th].nLines = nLines;
+        pthread_mutex_unlock(&(attr[th].startNext));
+    }
+    eliminate_local(mat_i, i, begin + (nthreads - 1) * nLines, end);
+    for (int th = 1; th < nthreads; th++)
+        pthread_mutex_lock(&(attr[th].finished));
+}
+
+void LU_mpi()
+{
+    MPI_Request req;
+    int cur = 0, next_local = 0; // next_local: 第一个全局行号大于当前步的本地行
+
+    if (owner(0) == rank_id)
+        memcpy(pivot_buf[0], local_row(local_index(0)), sizeof(ele_t) * n);
+    MPI_Ibcast(pivot_buf[0], n, MPI_FLOAT, owner(0), MPI_COMM_WORLD, &req);
+
+    for (int i = 0; i < n; i++)
+    {
+        MPI_Wait(&req, MPI_STATUS_IGNORE);
+        ele_t *mat_i = pivot_buf[cur];
+        bool ok = mat_i[i] != 0;
+        while (next_local < nLocal && global_index(next_local) <= i)
+            next_local++;
+
+        // 先算出下一行并立即开始广播，与本步其余行的消去重叠
+        int begin = next_local;
+        if (i + 1 < n)
+        {
+            if (owner(i + 1) == rank_id)
+            {
+                if (ok)
+                    eliminate_local(mat_i, i, next_local, next_local + 1);
+                memcpy(pivot_buf[cur ^ 1] + i + 1, local_row(next_local) + i + 1, sizeof(ele_t) * (n - i - 1));
+                begin++;
+            }
+            MPI_Ibcast(pivot_buf[cur ^ 1] + i + 1, n - i - 1, MPI_FLOAT, owner(i + 1), MPI_COMM_WORLD, &req);
+        }
+        if (ok)
+            eliminate_threads(mat_i, i, begin, nLocal);
+        cur ^= 1;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank_id);
+    MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+    if (provided < MPI_THREAD_FUNNELED && nthreads > 1)
+    { // 混合模式要求其他线程存在时主线程仍能调用MPI
+        if (rank_id == 0)
+            cerr << "MPI does not provide MPI_THREAD_FUNNELED, using 1 thread per process" << endl;
+        nthreads = 1;
+    }
+    n = argc > 1 ? atoi(argv[1]) : N;
+
+    nLocal = 0;
+    for (int r = 0; r < n; r++)
+        if (owner(r) == rank_id)
+            nLocal++;
+    local = (ele_t *)aligned_alloc(64, ((sizeof(ele_t) * n * max(nLocal, 1)) + 63) / 64 * 64);
+    pivot_buf[0] = new ele_t[n];
+    pivot_buf[1] = new ele_t[n];
+
+    // 每个进程只读自己的行，单个进程的内存占用约为 n*n/nprocs
+    // 文件的阶数必须等于 n，否则行长不同会读到错位的行（见 gauss_dat.h）
+    ifstream data("gauss.dat", ios::in | ios::binary | ios::ate);
+    gauss_header h;
+    off_t file_size = data ? (off_t)data.tellg() : 0;
+    data.seekg(0);
+    if (!data.read((char *)&h, sizeof(h)) || !gauss_header_ok(h, file_size, n))
+    {
+        cout << "rank " << rank_id << ": gauss.dat is not a " << n << "x" << n << " matrix, generate it with ./datagen -n " << n << endl;
+        MPI_Abort(MPI_COMM_WORLD, -1);
+    }
+    for (int l = 0; l < nLocal; l++)
+    {
+        data.seekg((streamoff)sizeof(h) + (streamoff)global_index(l) * n * sizeof(ele_t));
+        data.read((char *)local_row(l), n * sizeof(ele_t));
+    }
+    if (!data)
+    {
+        cout << "rank " << rank_id << ": failed to read gauss.dat" << endl;
+        MPI_Abort(MPI_COMM_WORLD, -1);
+    }
+    data.close();
+
+    for (int th = 1; th < nthreads; th++)
+    {
+        pthread_mutex_lock(&(attr[th].startNext));
+        pthread_mutex_lock(&(attr[th].finished));
+        int err = pthread_create(&threads[th], thread_attr(th), subthread_LU, (void *)&attr[th]);
+        if (err)
+        {
+            cout << "failed to create thread[" << th << "]" << endl;
+            MPI_Abort(MPI_COMM_WORLD, -1);
+        }
+    }
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    double start = MPI_Wtime();
+    LU_mpi();
+    MPI_Barrier(MPI_COMM_WORLD);
+    double time_used = MPI_Wtime() - start;
+
+    for (int th = 1; th < nthreads; th++)
+    {
+        attr[th].stop = true;
+        pthread_mutex_unlock(&(attr[th].startNext));
+        pthread_join(threads[th], NULL);
+    }
+
+    if (rank_id == 0)
+        cout << time_used << ',';
+#ifdef CHECK
+    double part = 0, total = 0;
+    for (int l = 0; l < nLocal; l++)
+        for (int k = global_index(l); k < n; k++)
+            part += fabs(local_row(l)[k]);
+    MPI_Reduce(&part, &total, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+    if (rank_id == 0)
+        cout << total << ',';
+#endif
+
+    free(local);
+    delete[] pivot_buf[0];
+    delete[] pivot_buf[1];
+    MPI_Finalize();
+    return 0;
+}
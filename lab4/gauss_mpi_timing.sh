@@ -0,0 +1,22 @@
+# !/bin/sh
+# 单机: ./gauss_mpi_timing.sh
+# 集群: HOSTFILE=$PBS_NODEFILE ./gauss_mpi_timing.sh （gauss.dat 需在各节点同一路径下）
+timestr=$(date +%m_%d_%H_%M)
+num_np=("1" "2" "4" "8")
+num_th=("1" "2" "4")
+hostfile=${HOSTFILE:+-hostfile $HOSTFILE}
+
+for j in {0..2}; do
+    mpicxx -O3 -march=native -w -pthread -DNUM_THREADS=${num_th[j]} ./gauss_mpi.cpp -o ./gauss_mpi_${num_th[j]}
+done
+
+for i in {1..32}; do
+    echo -n $((128 * i))"," >>./gauss_mpi_timing_$timestr.csv
+    for p in {0..3}; do
+        for j in {0..2}; do
+            echo "${num_np[p]} processes x ${num_th[j]} threads, n = "$((128 * i))
+            mpirun $hostfile --oversubscribe -np ${num_np[p]} ./gauss_mpi_${num_th[j]} $((128 * i)) >>./gauss_mpi_timing_$timestr.csv
+        done
+    done
+    echo "" >>./gauss_mpi_timing_$timestr.csv
+done
@@ -1,18 +1,13 @@
 # !/bin/sh
+# 只编译一次（-O3），由程序在同一进程中扫描规模和线程数（见 scaling.h），
+# 结果为 tidy CSV（强/弱扩展效率、Karp-Flatt），用 lab2/datav/time.py 画图
 timestr=$(date +%m_%d_%H_%M)
-lastfinish=$(date +%m_%d_%H_%M_%S)
-num_th=("1" "4" "8" "12" "16" "20")
-for i in {1..32}; do
-    echo -n $((128 * i))"," >>./gauss_timing_$timestr.csv
-    for j in {0..5}; do
-        g++ -O0 -march=native -w -pthread -DNUM_THREADS=$((${num_th[j]})) -DN=$((128 * i)) ./gauss.cpp -o ./gauss_test
-        echo "$(${num_th[i]}) threads"
-        echo "now calculating: "$((128 * i))
-        echo "time start: "$timestr
-        echo "last finish: "$lastfinish
-        echo "time now: "$(date +%m_%d_%H_%M_%S)
-        ./gauss_test >>./gauss_timing_$timestr.csv
-        lastfinish=$(date +%m_%d_%H_%M_%S)
-    done
-    echo "">>./gauss_timing_$timestr.csv
-done
+# 每个测试点预热1次、计时5次取中位数（见 bench.h）
+export BENCH_WARMUP=1 BENCH_REPT=5
+num_th="1,4,8,12,16,20"
+sizes=$(seq -s, 128 128 4096)
+
+g++ -O3 -march=native -w -pthread -DNUM_THREADS=20 -DN=4096 ./gauss.cpp -o ./gauss_test
+echo "time start: "$timestr
+SCALE_THREADS=$num_th SCALE_N=$sizes SCALE_OUT=./gauss_scaling_$timestr.csv ./gauss_test
+echo "time now: "$(date +%m_%d_%H_%M_%S)
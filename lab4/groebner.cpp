@@ -7,6 +7,15 @@
 #include <cmath>
 #include <string>
 #include <string.h>
+#include <stdint.h>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 #define PHILOSOPHY 能跑就行
 
@@ -20,10 +29,47 @@
 #define USE_SSE4
 #endif
 
+#include "affinity.h"
+#include "bench.h"
+#include "scaling.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#ifdef PSTL
+#include <execution>
+#include <numeric>
+#endif
+
 // #define DEBUG
+// #define SPARSE // 使用稀疏/稠密混合表示，不再定义稠密的输入矩阵（DEBUG 时除外，见 DENSE）
+// #define M4R // 使用四俄罗斯人法按批消元
+// #define LOCKFREE // 各线程独立消去自己的行，升格通过CAS抢占
+// #define PSTL // 编译 std::execution::par_unseq 版本，GCC 需要 -std=c++17 -ltbb
+// #define STREAM // 消元子常驻内存，被消元行分批从磁盘读入，结果边算边写出
+// #define IN_PLACE // 直接在输入矩阵上消元，不保留输入（输入被覆盖，只测一个函数）
+
+#ifndef ROW_BATCH
+#define ROW_BATCH 1024 // 流式模式每批读入的行数
+#endif
+#ifndef OUT_FILE
+#define OUT_FILE "groebner_result.txt" // 流式模式的输出，每行为消元后的降序列号
+#endif
+
+#ifndef M4R_K
+#define M4R_K 8 // 每批最多合并的主元列数，查找表大小为 2^M4R_K 行
+#endif
+
+#ifndef DENSE_RATIO
+#define DENSE_RATIO 8 // 非零列数超过 位图字数/DENSE_RATIO 时由列号表转为位图
+#endif
 
 #ifndef NUM_THREADS
-#define NUM_THREADS 16
+#define NUM_THREADS 16 // 线程数上限，决定线程数组大小；运行时的线程数为 nthreads
+#endif
+
+// 稠密位图及其内核。稀疏/流式版本计时时只用混合表示，不定义稠密数组；DEBUG 时仍与稠密版本对照
+#if !(defined(SPARSE) || defined(STREAM)) || defined(DEBUG)
+#define DENSE
 #endif
 
 // #ifndef DATA
@@ -68,54 +114,158 @@
 #define ROW 4535
 #endif
 
-#define mat_t unsigned int
-#define mat_L 32
-#define REPT 1
+#define mat_t uint64_t
+#define mat_L 64
+
+#ifndef BIN_FILE
+#define BIN_FILE DATA "groebner.bin" // 预处理好的二进制位图，由 ./groebner convert 生成
+#endif
 
 using namespace std;
 
+int nthreads = NUM_THREADS; // 运行时的线程数，扩展性扫描时逐个修改
+#ifdef IN_PLACE
+bool preserve_input = false;
+#else
+bool preserve_input = true;
+#endif
+
+#ifdef DENSE
 mat_t ele[COL][COL / mat_L + 1] = {0};
 mat_t row[ROW][COL / mat_L + 1] = {0};
 
-mat_t ele_tmp[COL][COL / mat_L + 1] __attribute__((aligned(64))) = {0};
-mat_t row_tmp[ROW][COL / mat_L + 1] __attribute__((aligned(64))) = {0};
+mat_t ele_buf[COL][COL / mat_L + 1] __attribute__((aligned(64))) = {0};
+mat_t row_buf[ROW][COL / mat_L + 1] __attribute__((aligned(64))) = {0};
+
+// 工作矩阵：保留输入时为 ele_buf/row_buf，原地消元时为输入本身
+mat_t (*ele_tmp)[COL / mat_L + 1] = ele_buf;
+mat_t (*row_tmp)[COL / mat_L + 1] = row_buf;
+
+// 选定工作矩阵并拷贝消元子，被消元行由之后负责它们的线程用 copy_rows 拷贝（首次访问定位内存）
+inline void prepare(mat_t ele[COL][COL / mat_L + 1], mat_t row[ROW][COL / mat_L + 1])
+{
+    ele_tmp = preserve_input ? ele_buf : ele;
+    row_tmp = preserve_input ? row_buf : row;
+    if (preserve_input)
+        memcpy(ele_buf, ele, sizeof(mat_t) * COL * (COL / mat_L + 1));
+}
+
+inline void copy_rows(mat_t row[ROW][COL / mat_L + 1], int begin, int end)
+{
+    if (preserve_input && begin < end)
+        memcpy(row_buf[begin], row[begin], sizeof(mat_t) * (end - begin) * (COL / mat_L + 1));
+}
+#endif
+
+// 从第 from 列往下找最高的非零列，整字跳过零字，字内用前导零计数定位
+inline int row_lead(const mat_t *bits, int from)
+{
+    for (int p = from / mat_L; p >= 0; p--)
+        if (bits[p])
+            return p * mat_L + mat_L - 1 - __builtin_clzll(bits[p]);
+    return -1;
+}
+
+// row[0..last] ^= ele[0..last]，last 为消元子首项所在的字，更高的字全为0无需处理
+void xor_words_scalar(mat_t *row, const mat_t *ele, int last)
+{
+    for (int p = 0; p <= last; p++)
+        row[p] ^= ele[p];
+}
+
+#ifdef __amd64__
+__attribute__((target("avx2"))) void xor_words_avx2(mat_t *row, const mat_t *ele, int last)
+{
+    int p = 0;
+    for (; p + 8 <= last + 1; p += 8)
+    {
+        __m256i r0 = _mm256_loadu_si256((__m256i *)(row + p));
+        __m256i r1 = _mm256_loadu_si256((__m256i *)(row + p + 4));
+        r0 = _mm256_xor_si256(r0, _mm256_loadu_si256((const __m256i *)(ele + p)));
+        r1 = _mm256_xor_si256(r1, _mm256_loadu_si256((const __m256i *)(ele + p + 4)));
+        _mm256_storeu_si256((__m256i *)(row + p), r0);
+        _mm256_storeu_si256((__m256i *)(row + p + 4), r1);
+    }
+    for (; p <= last; p++)
+        row[p] ^= ele[p];
+}
+
+__attribute__((target("avx512f"))) void xor_words_avx512(mat_t *row, const mat_t *ele, int last)
+{
+    int p = 0;
+    for (; p + 8 <= last + 1; p += 8)
+        _mm512_storeu_si512(row + p, _mm512_xor_si512(_mm512_loadu_si512(row + p), _mm512_loadu_si512(ele + p)));
+    if (p <= last)
+    { // 尾部用掩码处理
+        __mmask8 m = (__mmask8)((1u << (last + 1 - p)) - 1);
+        _mm512_mask_storeu_epi64(row + p, m, _mm512_xor_si512(_mm512_maskz_loadu_epi64(m, row + p), _mm512_maskz_loadu_epi64(m, ele + p)));
+    }
+}
+#endif
+
+#ifdef __ARM_NEON
+void xor_words_neon(mat_t *row, const mat_t *ele, int last)
+{
+    int p = 0;
+    for (; p + 2 <= last + 1; p += 2)
+        vst1q_u64(row + p, veorq_u64(vld1q_u64(row + p), vld1q_u64(ele + p)));
+    for (; p <= last; p++)
+        row[p] ^= ele[p];
+}
+#endif
+
+// 运行时按CPU支持的指令集选择异或实现
+void (*xor_words)(mat_t *, const mat_t *, int) = xor_words_scalar;
+const char *xor_isa = "scalar";
+
+void select_xor()
+{
+#if defined(__amd64__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        xor_words = xor_words_avx512, xor_isa = "avx512";
+    else if (__builtin_cpu_supports("avx2"))
+        xor_words = xor_words_avx2, xor_isa = "avx2";
+#elif defined(__ARM_NEON)
+    xor_words = xor_words_neon, xor_isa = "neon";
+#endif
+}
 
 void test(void (*func)(mat_t[COL][COL / mat_L + 1], mat_t[ROW][COL / mat_L + 1]), const char *msg)
 {
-    timespec start, end;
-    double time_used = 0;
-    // cout << "result: " << func(arr, len) << "    ";
-    clock_gettime(CLOCK_REALTIME, &start);
-    // for (int i = 0; i < REPT*(int)pow(2,(20-(int)(log2(len)))); i++)
-    for (int i = 0; i < REPT; i++)
-        func(ele, row);
-    clock_gettime(CLOCK_REALTIME, &end);
-    time_used += end.tv_sec - start.tv_sec;
-    time_used += double(end.tv_nsec - start.tv_nsec) / 1000000000;
-    cout << time_used << ',';
+#ifdef DENSE
+    bench_result r = bench([&]
+                           { func(ele, row); },
+                           preserve_input);
+#else // 稀疏/流式版本不使用稠密参数
+    bench_result r = bench([&]
+                           { func(NULL, NULL); },
+                           preserve_input);
+#endif
+    cout << r.median << ',';
+    perf_csv(cout, r.perf, r.reps);
+    // 工作量按输入的消元子和被消元行的字节数计
+    bench_record("groebner", msg, COL, nthreads, xor_isa, (double)(ELE + ROW) * (COL / mat_L + 1) * sizeof(mat_t), "GB/s", r);
 }
 
+#ifdef DENSE
 void groebner(mat_t ele[COL][COL / mat_L + 1], mat_t row[ROW][COL / mat_L + 1])
 {
     // ele=消元子，row=被消元行
-    memcpy(ele_tmp, ele, sizeof(mat_t) * COL * (COL / mat_L + 1));
-    memcpy(row_tmp, row, sizeof(mat_t) * ROW * (COL / mat_L + 1));
+    prepare(ele, row);
+    copy_rows(row, 0, ROW);
     for (int i = 0; i < ROW; i++)
-    { // 遍历被消元行
-        for (int j = COL; j >= 0; j--)
-        { // 遍历列
-            if (row_tmp[i][j / mat_L] & ((mat_t)1 << (j % mat_L)))
-            { // 当前位置有元素，需要消元
-                if (ele_tmp[j][j / mat_L] & ((mat_t)1 << (j % mat_L)))
-                { //找到对应消元子
-                    for (int p = COL / mat_L; p >= 0; p--)
-                        row_tmp[i][p] ^= ele_tmp[j][p];
-                }
-                else
-                { // 找不到对应消元子，升格当前消元行
-                    memcpy(ele_tmp[j], row_tmp[i], (COL / mat_L + 1) * sizeof(mat_t));
-                    break;
-                }
+    { // 遍历被消元行，每次直接跳到当前首项
+        for (int j = row_lead(row_tmp[i], COL); j >= 0; j = row_lead(row_tmp[i], j))
+        {
+            if (ele_tmp[j][j / mat_L] & ((mat_t)1 << (j % mat_L)))
+            { //找到对应消元子
+                xor_words(row_tmp[i], ele_tmp[j], j / mat_L);
+            }
+            else
+            { // 找不到对应消元子，升格当前消元行
+                memcpy(ele_tmp[j], row_tmp[i], (COL / mat_L + 1) * sizeof(mat_t));
+                break;
             }
         }
     }
@@ -135,8 +285,8 @@ void groebner(mat_t ele[COL][COL / mat_L + 1], mat_t row[ROW][COL / mat_L + 1])
 void groebner_new(mat_t ele[COL][COL / mat_L + 1], mat_t row[ROW][COL / mat_L + 1])
 {
     // ele=消元子，row=被消元行
-    memcpy(ele_tmp, ele, sizeof(mat_t) * COL * (COL / mat_L + 1));
-    memcpy(row_tmp, row, sizeof(mat_t) * ROW * (COL / mat_L + 1));
+    prepare(ele, row);
+    copy_rows(row, 0, ROW);
 
     bool upgraded[ROW] = {0};
 
@@ -150,8 +300,7 @@ void groebner_new(mat_t ele[COL][COL / mat_L + 1], mat_t row[ROW][COL / mat_L +
                     continue;
                 if (row_tmp[i][j / mat_L] & ((mat_t)1 << (j % mat_L)))
                 { // 如果当前行需要消元
-                    for (int p = COL / mat_L; p >= 0; p--)
-                        row_tmp[i][p] ^= ele_tmp[j][p];
+                    xor_words(row_tmp[i], ele_tmp[j], j / mat_L);
                 }
             }
         }
@@ -186,30 +335,36 @@ void groebner_new(mat_t ele[COL][COL / mat_L + 1], mat_t row[ROW][COL / mat_L +
 
 struct groebnerData
 {
-    mat_t (*ele)[COL][COL / mat_L + 1];
-    mat_t (*row)[ROW][COL / mat_L + 1];
+    mat_t (*ele)[COL / mat_L + 1];
+    mat_t (*row)[COL / mat_L + 1];
+    mat_t (*src)[COL / mat_L + 1]; // 输入的被消元行，线程启动时先拷贝自己的行
     bool (*upgraded)[ROW];
     int j, begin, nLines;
+    int b; // 批消元时本批的列数
     pthread_mutex_t finished = PTHREAD_MUTEX_INITIALIZER;
     pthread_mutex_t startNext = PTHREAD_MUTEX_INITIALIZER;
+    bool stop = false; // 常驻线程退出标志
 };
 
 void *subthread_groebner(void *_params)
 {
     groebnerData *params = (groebnerData *)_params;
     int j;
+    copy_rows(params->src, params->begin, params->begin + params->nLines);
+    pthread_mutex_unlock(&(params->finished));
     while (true)
     {
         pthread_mutex_lock(&(params->startNext));
+        if (params->stop)
+            return NULL;
         j = params->j;
         for (int i = params->begin; i < params->begin + params->nLines; i++)
         { // 遍历被消元行
             if ((*params->upgraded)[i])
                 continue;
-            if ((*params->row)[i][j / mat_L] & ((mat_t)1 << (j % mat_L)))
+            if (params->row[i][j / mat_L] & ((mat_t)1 << (j % mat_L)))
             { // 如果当前行需要消元
-                for (int p = COL / mat_L; p >= 0; p--)
-                    (*params->row)[i][p] ^= (*params->ele)[j][p];
+                xor_words(params->row[i], params->ele[j], j / mat_L);
             }
         }
         pthread_mutex_unlock(&(params->finished));
@@ -219,36 +374,42 @@ void *subthread_groebner(void *_params)
 void groebner_pthread(mat_t ele[COL][COL / mat_L + 1], mat_t row[ROW][COL / mat_L + 1])
 {
     // ele=消元子，row=被消元行
-    memcpy(ele_tmp, ele, sizeof(mat_t) * COL * (COL / mat_L + 1));
-    memcpy(row_tmp, row, sizeof(mat_t) * ROW * (COL / mat_L + 1));
+    prepare(ele, row);
 
     bool upgraded[ROW] = {0};
     pthread_t threads[NUM_THREADS];
     groebnerData attr[NUM_THREADS];
 
-    for (int th = 0; th < NUM_THREADS; th++)
+    // 线程启动后先拷贝自己负责的行，主线程拷贝余下的行
+    for (int th = 0; th < nthreads; th++)
     {
+        attr[th].src = row;
+        attr[th].begin = th * (ROW / nthreads);
+        attr[th].nLines = ROW / nthreads;
         pthread_mutex_lock(&(attr[th].startNext));
         pthread_mutex_lock(&(attr[th].finished));
-        int err = pthread_create(&threads[th], NULL, subthread_groebner, (void *)&attr[th]);
+        int err = pthread_create(&threads[th], thread_attr(th), subthread_groebner, (void *)&attr[th]);
         if (err)
         {
             cout << "failed to create thread[" << th << "]" << endl;
             exit(-1);
         }
     }
+    copy_rows(row, ROW / nthreads * nthreads, ROW);
+    for (int th = 0; th < nthreads; th++)
+        pthread_mutex_lock(&(attr[th].finished));
 
     for (int j = COL; j >= 0; j--)
     { // 遍历消元子
         if (ele_tmp[j][j / mat_L] & ((mat_t)1 << (j % mat_L)))
         { // 如果存在对应消元子则进行消元
 
-            int nLines = ROW / NUM_THREADS;
+            int nLines = ROW / nthreads;
 
-            for (int th = 0; th < NUM_THREADS; th++)
+            for (int th = 0; th < nthreads; th++)
             {
-                attr[th].ele = &ele_tmp;
-                attr[th].row = &row_tmp;
+                attr[th].ele = ele_tmp;
+                attr[th].row = row_tmp;
                 attr[th].upgraded = &upgraded;
                 attr[th].j = j;
                 attr[th].begin = th * nLines;
@@ -256,18 +417,17 @@ void groebner_pthread(mat_t ele[COL][COL / mat_L + 1], mat_t row[ROW][COL / mat_
                 pthread_mutex_unlock(&(attr[th].startNext));
             }
 
-            for (int i = ROW / NUM_THREADS * NUM_THREADS; i < ROW; i++)
+            for (int i = ROW / nthreads * nthreads; i < ROW; i++)
             { // 遍历被消元行
                 if (upgraded[i])
                     continue;
                 if (row_tmp[i][j / mat_L] & ((mat_t)1 << (j % mat_L)))
                 { // 如果当前行需要消元
-                    for (int p = COL / mat_L; p >= 0; p--)
-                        row_tmp[i][p] ^= ele_tmp[j][p];
+                    xor_words(row_tmp[i], ele_tmp[j], j / mat_L);
                 }
             }
 
-            for (int th = 0; th < NUM_THREADS; th++)
+            for (int th = 0; th < nthreads; th++)
                 pthread_mutex_lock(&(attr[th].finished));
         }
         else
@@ -287,6 +447,116 @@ void groebner_pthread(mat_t ele[COL][COL / mat_L + 1], mat_t row[ROW][COL / mat_
         }
     }
 
+    // 通知常驻线程退出，避免其阻塞在已失效的栈上
+    for (int th = 0; th < nthreads; th++)
+    {
+        attr[th].stop = true;
+        pthread_mutex_unlock(&(attr[th].startNext));
+        pthread_join(threads[th], NULL);
+    }
+
+#ifdef DEBUG
+    for (int i = 0; i < ROW; i++)
+    {
+        cout << i << ": ";
+        for (int j = COL; j >= 0; j--)
+            if (row_tmp[i][j / mat_L] & ((mat_t)1 << (j % mat_L)))
+                cout << j << ' ';
+        cout << endl;
+    }
+#endif
+}
+
+// 四俄罗斯人法：连续 b 个都有消元子的主元列合成一批，预先算出这 b 个消元子的全部 2^b 种组合，
+// 每个被消元行按这 b 列上的取值查表异或一次，代替逐列 b 次遍历
+mat_t m4r_table[1 << M4R_K][COL / mat_L + 1] __attribute__((aligned(64)));
+
+// 从第j列往下数，连续有消元子的列数（不超过 M4R_K）
+inline int m4r_batch(int j)
+{
+    int b = 0;
+    while (b < M4R_K && j - b >= 0 && (ele_tmp[j - b][(j - b) / mat_L] & ((mat_t)1 << ((j - b) % mat_L))))
+        b++;
+    return b;
+}
+
+// 第 lo..lo+b-1 列上的取值
+inline unsigned m4r_chunk(const mat_t *r, int lo, int b)
+{
+    int p = lo / mat_L, s = lo % mat_L;
+    mat_t v = r[p] >> s;
+    if (s + b > mat_L)
+        v |= r[p + 1] << (mat_L - s);
+    return (unsigned)(v & (((mat_t)1 << b) - 1));
+}
+
+void m4r_build(int j, int b)
+{
+    int lo = j - b + 1, words = j / mat_L + 1;
+    // 先把批内消元子化简为互不包含彼此首项的形式，表项 1<<t 对应第 lo+t 列
+    for (int t = 0; t < b; t++)
+    {
+        mat_t *e = m4r_table[1 << t];
+        memcpy(e, ele_tmp[lo + t], words * sizeof(mat_t));
+        for (int u = t - 1; u >= 0; u--)
+            if (e[(lo + u) / mat_L] & ((mat_t)1 << ((lo + u) % mat_L)))
+                xor_words(e, m4r_table[1 << u], (lo + u) / mat_L);
+    }
+    // 其余表项 = 去掉最低位的表项 ^ 最低位对应的消元子
+    memset(m4r_table[0], 0, words * sizeof(mat_t));
+    for (unsigned v = 3; v < (1u << b); v++)
+    {
+        unsigned low = v & -v;
+        if (v == low)
+            continue;
+        memcpy(m4r_table[v], m4r_table[v ^ low], words * sizeof(mat_t));
+        xor_words(m4r_table[v], m4r_table[low], words - 1);
+    }
+}
+
+inline void m4r_apply(mat_t *r, int j, int b)
+{
+    unsigned v = m4r_chunk(r, j - b + 1, b);
+    if (v)
+        xor_words(r, m4r_table[v], j / mat_L);
+}
+
+void groebner_m4r(mat_t ele[COL][COL / mat_L + 1], mat_t row[ROW][COL / mat_L + 1])
+{
+    // ele=消元子，row=被消元行
+    prepare(ele, row);
+    copy_rows(row, 0, ROW);
+
+    bool upgraded[ROW] = {0};
+
+    for (int j = COL - 1; j >= 0; j--)
+    {
+        int b = m4r_batch(j);
+        if (b > 0)
+        { // 第 j..j-b+1 列都有消元子，一次查表完成
+            m4r_build(j, b);
+            for (int i = 0; i < ROW; i++)
+                if (!upgraded[i])
+                    m4r_apply(row_tmp[i], j, b);
+            j -= b - 1;
+        }
+        else
+        { // 不存在对应消元子，则找出第一个被消元行升格
+            for (int i = 0; i < ROW; i++)
+            {
+                if (upgraded[i])
+                    continue;
+                if (row_tmp[i][j / mat_L] & ((mat_t)1 << (j % mat_L)))
+                {
+                    memcpy(ele_tmp[j], row_tmp[i], (COL / mat_L + 1) * sizeof(mat_t));
+                    upgraded[i] = true;
+                    j++;
+                    break;
+                }
+            }
+        }
+    }
+
 #ifdef DEBUG
     for (int i = 0; i < ROW; i++)
     {
@@ -299,32 +569,804 @@ void groebner_pthread(mat_t ele[COL][COL / mat_L + 1], mat_t row[ROW][COL / mat_
 #endif
 }
 
-int main()
+void *subthread_groebner_m4r(void *_params)
 {
-    // cout << (string)DATA + (string) "1.txt" << endl;
-    ifstream data_ele((string)DATA + (string) "1.txt", ios::in);
-    int temp, header;
-    string line;
-    for (int i = 0; i < ELE; i++)
+    groebnerData *params = (groebnerData *)_params;
+    copy_rows(params->src, params->begin, params->begin + params->nLines);
+    pthread_mutex_unlock(&(params->finished));
+    while (true)
+    {
+        pthread_mutex_lock(&(params->startNext));
+        if (params->stop)
+            return NULL;
+        for (int i = params->begin; i < params->begin + params->nLines; i++)
+            if (!(*params->upgraded)[i])
+                m4r_apply(params->row[i], params->j, params->b);
+        pthread_mutex_unlock(&(params->finished));
+    }
+}
+
+// 主线程建表，各线程查表消去自己的行，每批只同步一次
+void groebner_m4r_pthread(mat_t ele[COL][COL / mat_L + 1], mat_t row[ROW][COL / mat_L + 1])
+{
+    prepare(ele, row);
+
+    bool upgraded[ROW] = {0};
+    pthread_t threads[NUM_THREADS];
+    groebnerData attr[NUM_THREADS];
+
+    // 线程启动后先拷贝自己负责的行，主线程拷贝余下的行
+    for (int th = 0; th < nthreads; th++)
     {
-        getline(data_ele, line);
-        istringstream line_iss(line);
-        line_iss >> header;
-        ele[header][header / mat_L] += (mat_t)1 << (header % mat_L);
-        while (line_iss >> temp)
-            ele[header][temp / mat_L] += (mat_t)1 << (temp % mat_L);
+        attr[th].src = row;
+        attr[th].begin = th * (ROW / nthreads);
+        attr[th].nLines = ROW / nthreads;
+        pthread_mutex_lock(&(attr[th].startNext));
+        pthread_mutex_lock(&(attr[th].finished));
+        int err = pthread_create(&threads[th], thread_attr(th), subthread_groebner_m4r, (void *)&attr[th]);
+        if (err)
+        {
+            cout << "failed to create thread[" << th << "]" << endl;
+            exit(-1);
+        }
     }
-    data_ele.close();
+    copy_rows(row, ROW / nthreads * nthreads, ROW);
+    for (int th = 0; th < nthreads; th++)
+        pthread_mutex_lock(&(attr[th].finished));
 
-    ifstream data_row((string)DATA + (string) "2.txt", ios::in);
+    for (int j = COL - 1; j >= 0; j--)
+    {
+        int b = m4r_batch(j);
+        if (b > 0)
+        {
+            m4r_build(j, b);
+            int nLines = ROW / nthreads;
+            for (int th = 0; th < nthreads; th++)
+            {
+                attr[th].row = row_tmp;
+                attr[th].upgraded = &upgraded;
+                attr[th].j = j;
+                attr[th].b = b;
+                attr[th].begin = th * nLines;
+                attr[th].nLines = nLines;
+                pthread_mutex_unlock(&(attr[th].startNext));
+            }
+            for (int i = ROW / nthreads * nthreads; i < ROW; i++)
+                if (!upgraded[i])
+                    m4r_apply(row_tmp[i], j, b);
+            for (int th = 0; th < nthreads; th++)
+                pthread_mutex_lock(&(attr[th].finished));
+            j -= b - 1;
+        }
+        else
+        { // 不存在对应消元子，则找出第一个被消元行升格
+            for (int i = 0; i < ROW; i++)
+            {
+                if (upgraded[i])
+                    continue;
+                if (row_tmp[i][j / mat_L] & ((mat_t)1 << (j % mat_L)))
+                {
+                    memcpy(ele_tmp[j], row_tmp[i], (COL / mat_L + 1) * sizeof(mat_t));
+                    upgraded[i] = true;
+                    j++;
+                    break;
+                }
+            }
+        }
+    }
+
+    // 通知常驻线程退出，避免其阻塞在已失效的栈上
+    for (int th = 0; th < nthreads; th++)
+    {
+        attr[th].stop = true;
+        pthread_mutex_unlock(&(attr[th].startNext));
+        pthread_join(threads[th], NULL);
+    }
+
+#ifdef DEBUG
     for (int i = 0; i < ROW; i++)
     {
-        getline(data_row, line);
-        istringstream line_iss(line);
-        while (line_iss >> temp)
-            row[i][temp / mat_L] += (mat_t)1 << (temp % mat_L);
+        cout << i << ": ";
+        for (int j = COL; j >= 0; j--)
+            if (row_tmp[i][j / mat_L] & ((mat_t)1 << (j % mat_L)))
+                cout << j << ' ';
+        cout << endl;
+    }
+#endif
+}
+
+// 无全局同步的并行消元：每个线程独立地逐行消去（同 groebner），
+// 行首项遇到空的消元子位置时用CAS抢占，抢到的行升格并发布，其余线程只等这一个位置
+// 升格哪一行取决于线程调度，但最终消元子首项集合与串行版本相同
+enum
+{
+    SLOT_EMPTY,
+    SLOT_CLAIMED,
+    SLOT_READY
+};
+atomic<int> slot[COL];
+atomic<int> next_row;
+pthread_barrier_t copy_done;
+
+struct lockfreeData
+{
+    mat_t (*row)[COL / mat_L + 1]; // 输入的被消元行
+    int th;
+};
+
+void *subthread_groebner_lockfree(void *_params)
+{
+    lockfreeData *params = (lockfreeData *)_params;
+    int th = params->th;
+    // 行是动态领取的，拷贝按连续块分给各线程，全部拷完后才开始消元
+    copy_rows(params->row, th * ROW / nthreads, (th + 1) * ROW / nthreads);
+    pthread_barrier_wait(&copy_done);
+    for (int i = next_row.fetch_add(1); i < ROW; i = next_row.fetch_add(1))
+    {
+        for (int j = row_lead(row_tmp[i], COL); j >= 0; j = row_lead(row_tmp[i], j))
+        {
+            int state = slot[j].load(memory_order_acquire);
+            if (state == SLOT_EMPTY)
+            {
+                if (slot[j].compare_exchange_strong(state, SLOT_CLAIMED, memory_order_acq_rel))
+                { // 抢到了，当前行升格
+                    memcpy(ele_tmp[j], row_tmp[i], (COL / mat_L + 1) * sizeof(mat_t));
+                    slot[j].store(SLOT_READY, memory_order_release);
+                    break;
+                }
+            }
+            while (state != SLOT_READY) // 别的行正在升格，等它发布
+            {
+                sched_yield();
+                state = slot[j].load(memory_order_acquire);
+            }
+            xor_words(row_tmp[i], ele_tmp[j], j / mat_L);
+        }
+    }
+    return NULL;
+}
+
+void groebner_lockfree(mat_t ele[COL][COL / mat_L + 1], mat_t row[ROW][COL / mat_L + 1])
+{
+    prepare(ele, row);
+    for (int j = 0; j < COL; j++)
+        slot[j].store(ele_tmp[j][j / mat_L] & ((mat_t)1 << (j % mat_L)) ? SLOT_READY : SLOT_EMPTY, memory_order_relaxed);
+    next_row.store(0);
+
+    pthread_t threads[NUM_THREADS];
+    lockfreeData attr[NUM_THREADS];
+    pthread_barrier_init(&copy_done, NULL, nthreads);
+    for (int th = 0; th < nthreads; th++)
+    {
+        attr[th] = {row, th};
+        int err = pthread_create(&threads[th], thread_attr(th), subthread_groebner_lockfree, (void *)&attr[th]);
+        if (err)
+        {
+            cout << "failed to create thread[" << th << "]" << endl;
+            exit(-1);
+        }
     }
-    data_row.close();
+    for (int th = 0; th < nthreads; th++)
+        pthread_join(threads[th], NULL);
+    pthread_barrier_destroy(&copy_done);
+
+#ifdef DEBUG
+    for (int i = 0; i < ROW; i++)
+    {
+        cout << i << ": ";
+        for (int j = COL; j >= 0; j--)
+            if (row_tmp[i][j / mat_L] & ((mat_t)1 << (j % mat_L)))
+                cout << j << ' ';
+        cout << endl;
+    }
+#endif
+}
+
+#ifdef _OPENMP
+// 与 groebner_new 相同的按列消元，调度方式由 omp_set_schedule 或 OMP_SCHEDULE 决定
+void groebner_omp(mat_t ele[COL][COL / mat_L + 1], mat_t row[ROW][COL / mat_L + 1])
+{
+    // ele=消元子，row=被消元行
+    prepare(ele, row);
+    bool upgraded[ROW] = {0};
+    vector<int> pick(COL + 1, -1); // 每列升格的行，按列分开存放，快线程进入下一列时不会覆盖
+#pragma omp parallel num_threads(nthreads)
+    {
+#pragma omp for schedule(static)
+        for (int i = 0; i < ROW; i++)
+            copy_rows(row, i, i + 1);
+        for (int j = COL; j >= 0; j--)
+        { // 遍历消元子，各线程走同样的列序
+            const mat_t *e = ele_tmp[j];
+            if (!(e[j / mat_L] & ((mat_t)1 << (j % mat_L))))
+            { // 不存在对应消元子，由一个线程找出第一个被消元行升格，single 结束处有隐式屏障
+#pragma omp single
+                for (int i = 0; i < ROW; i++)
+                    if (!upgraded[i] && (row_tmp[i][j / mat_L] & ((mat_t)1 << (j % mat_L))))
+                    {
+                        pick[j] = i;
+                        upgraded[i] = true;
+                        break;
+                    }
+                if (pick[j] < 0)
+                    continue;
+                e = row_tmp[pick[j]]; // 升格的行不再被消去，直接作为本列的消元子
+            }
+#pragma omp for schedule(runtime)
+            for (int i = 0; i < ROW; i++)
+                if (!upgraded[i] && (row_tmp[i][j / mat_L] & ((mat_t)1 << (j % mat_L))))
+                    xor_words(row_tmp[i], e, j / mat_L);
+            // 到这里所有线程都已读过 ele_tmp[j]，可以写入
+            if (pick[j] >= 0)
+            {
+#pragma omp single nowait
+                memcpy(ele_tmp[j], row_tmp[pick[j]], (COL / mat_L + 1) * sizeof(mat_t));
+            }
+        }
+    }
+
+#ifdef DEBUG
+    for (int i = 0; i < ROW; i++)
+    {
+        cout << i << ": ";
+        for (int j = COL; j >= 0; j--)
+            if (row_tmp[i][j / mat_L] & ((mat_t)1 << (j % mat_L)))
+                cout << j << ' ';
+        cout << endl;
+    }
+#endif
+}
+#endif
+
+#ifdef PSTL
+// 线程数由并行算法的实现决定（libstdc++ 下为 TBB 的默认线程池），不受 nthreads 控制
+void groebner_pstl(mat_t ele[COL][COL / mat_L + 1], mat_t row[ROW][COL / mat_L + 1])
+{
+    // ele=消元子，row=被消元行
+    prepare(ele, row);
+    static bool upgraded[ROW];
+    static int idx[ROW];
+    memset(upgraded, 0, sizeof(upgraded));
+    iota(idx, idx + ROW, 0);
+    for_each(execution::par_unseq, idx, idx + ROW, [=](int i)
+             { copy_rows(row, i, i + 1); });
+    for (int j = COL; j >= 0; j--)
+    {
+        if (!(ele_tmp[j][j / mat_L] & ((mat_t)1 << (j % mat_L))))
+        { // 不存在对应消元子，找出第一个被消元行升格
+            for (int i = 0; i < ROW; i++)
+                if (!upgraded[i] && (row_tmp[i][j / mat_L] & ((mat_t)1 << (j % mat_L))))
+                {
+                    memcpy(ele_tmp[j], row_tmp[i], (COL / mat_L + 1) * sizeof(mat_t));
+                    upgraded[i] = true;
+                    break;
+                }
+            if (!(ele_tmp[j][j / mat_L] & ((mat_t)1 << (j % mat_L))))
+                continue;
+        }
+        for_each(execution::par_unseq, idx, idx + ROW, [=](int i)
+                 {
+                     if (!upgraded[i] && (row_tmp[i][j / mat_L] & ((mat_t)1 << (j % mat_L))))
+                         xor_words(row_tmp[i], ele_tmp[j], j / mat_L); });
+    }
+
+#ifdef DEBUG
+    for (int i = 0; i < ROW; i++)
+    {
+        cout << i << ": ";
+        for (int j = COL; j >= 0; j--)
+            if (row_tmp[i][j / mat_L] & ((mat_t)1 << (j % mat_L)))
+                cout << j << ' ';
+        cout << endl;
+    }
+#endif
+}
+#endif
+
+typedef void (*groebner_func)(mat_t[COL][COL / mat_L + 1], mat_t[ROW][COL / mat_L + 1]);
+
+// 按名称选出后端对应的内核，未编译进来的返回 NULL：
+//   pthread  常驻线程版本（nthreads 为1时为串行版本）
+//   omp_static / omp_dynamic / omp_guided  OpenMP，对应的调度方式
+//   pstl     std::execution::par_unseq
+//   m4r      四俄罗斯人查表版本（nthreads 为1时为串行版本），lockfree  无锁版本
+// serial 为真时 pthread/m4r 在1线程时换成串行版本；扩展性扫描传 false，各线程数用同一个内核
+groebner_func backend_kernel(const string &name, bool serial = true)
+{
+    if (name == "pthread")
+        return serial && nthreads == 1 ? groebner : groebner_pthread;
+    if (name == "m4r")
+        return serial && nthreads == 1 ? groebner_m4r : groebner_m4r_pthread;
+    if (name == "lockfree")
+        return groebner_lockfree;
+#ifdef _OPENMP
+    if (name == "omp_static" || name == "omp_dynamic" || name == "omp_guided")
+    {
+        omp_set_schedule(name == "omp_static" ? omp_sched_static : name == "omp_dynamic" ? omp_sched_dynamic
+                                                                                         : omp_sched_guided,
+                         0);
+        return groebner_omp;
+    }
+#endif
+#ifdef PSTL
+    if (name == "pstl")
+        return groebner_pstl;
+#endif
+    return NULL;
+}
+
+// 逗号分隔的列表拆成各项
+vector<string> split_list(const char *list)
+{
+    vector<string> items;
+    string s = list;
+    for (size_t pos = 0; pos <= s.size();)
+    {
+        size_t end = s.find(',', pos);
+        if (end == string::npos)
+            end = s.size();
+        items.push_back(s.substr(pos, end - pos));
+        pos = end + 1;
+    }
+    return items;
+}
+
+// 测试环境变量 BACKEND 中以逗号分隔的各后端，"后端名,时间," 依次输出到同一行，未编译进来的后端时间为 "-"
+void test_backends(const char *backend)
+{
+    for (const string &name : split_list(backend))
+    {
+        groebner_func func = backend_kernel(name);
+        cout << name << ',';
+        if (func)
+            test(func, name.c_str());
+        else
+            cout << "-,";
+    }
+}
+
+// 扩展性扫描（见 scaling.h），规模由数据集决定，只做强扩展
+void scale_backends(const char *backend)
+{
+    for (const string &name : split_list(backend))
+    {
+        if (!backend_kernel(name))
+        {
+            cout << name << ": not compiled in" << endl;
+            continue;
+        }
+        scale_sweep("groebner", name.c_str(), {COL}, COL, 0, NUM_THREADS, [&](int, int p)
+                    {
+                        nthreads = p;
+                        groebner_func func = backend_kernel(name, false); // 1线程的基准也用同一个内核
+                        return bench([&]
+                                     { func(ele, row); },
+                                     preserve_input); });
+    }
+    nthreads = NUM_THREADS;
+}
+#endif
+
+// 稀疏/稠密混合表示的一行：非零列少时存降序列号表，超过阈值后转为位图
+struct hybrid_row
+{
+    vector<int> idx;    // 稀疏表示：降序列号
+    vector<mat_t> bits; // 稠密表示：位图，为空时使用 idx
+    int lead = -1;      // 首项列号，-1 为零行
+};
+
+vector<hybrid_row> ele_sp(COL + 1), row_sp(ROW);
+vector<hybrid_row> ele_sp_tmp, row_sp_tmp;
+vector<int> ele_sp_dirty; // 本次运行中升格的消元子首项
+
+// 工作消元子恢复为输入：第一次整体拷贝，之后只恢复上次运行升格的行，不再每次拷贝全部消元子
+void reset_ele_sp()
+{
+    if (ele_sp_tmp.size() != ele_sp.size())
+        ele_sp_tmp = ele_sp;
+    else
+        for (int j : ele_sp_dirty)
+            ele_sp_tmp[j] = ele_sp[j];
+    ele_sp_dirty.clear();
+}
+
+inline bool is_dense(const hybrid_row &r)
+{
+    return !r.bits.empty();
+}
+
+void densify(hybrid_row &r)
+{
+    r.bits.assign(COL / mat_L + 1, 0);
+    for (int c : r.idx)
+        r.bits[c / mat_L] ^= (mat_t)1 << (c % mat_L);
+    r.idx.clear();
+}
+
+// r ^= e（两者首项相同），代价与非零数或首项所在字数成正比
+void hybrid_xor(hybrid_row &r, const hybrid_row &e, vector<int> &buf)
+{
+    if (!is_dense(r) && !is_dense(e))
+    { // 两个降序列号表求对称差
+        buf.clear();
+        vector<int>::const_iterator a = r.idx.begin(), b = e.idx.begin();
+        while (a != r.idx.cend() && b != e.idx.cend())
+        {
+            if (*a > *b)
+                buf.push_back(*a++);
+            else if (*a < *b)
+                buf.push_back(*b++);
+            else
+                a++, b++;
+        }
+        buf.insert(buf.end(), a, r.idx.cend());
+        buf.insert(buf.end(), b, e.idx.cend());
+        r.idx.swap(buf);
+        r.lead = r.idx.empty() ? -1 : r.idx[0];
+        if ((int)r.idx.size() * DENSE_RATIO > COL / mat_L + 1)
+            densify(r);
+        return;
+    }
+    if (!is_dense(r))
+        densify(r);
+    if (is_dense(e))
+        xor_words(r.bits.data(), e.bits.data(), r.lead / mat_L);
+    else
+        for (int c : e.idx)
+            r.bits[c / mat_L] ^= (mat_t)1 << (c % mat_L);
+    r.lead = row_lead(r.bits.data(), r.lead);
+}
+
+// 用 ele_sp_tmp 消去一行，找不到消元子时升格
+void reduce_hybrid(hybrid_row &r, vector<int> &buf)
+{
+    while (r.lead >= 0)
+    {
+        hybrid_row &e = ele_sp_tmp[r.lead];
+        if (e.lead >= 0) // 找到对应消元子
+            hybrid_xor(r, e, buf);
+        else
+        { // 找不到对应消元子，升格当前消元行
+            e = r;
+            ele_sp_dirty.push_back(r.lead);
+            break;
+        }
+    }
+}
+
+void groebner_sparse(mat_t[COL][COL / mat_L + 1], mat_t[ROW][COL / mat_L + 1])
+{
+    // 稠密参数不使用，输入在 ele_sp/row_sp 中
+    reset_ele_sp();
+    row_sp_tmp = row_sp;
+    vector<int> buf;
+    for (int i = 0; i < ROW; i++) // 遍历被消元行
+        reduce_hybrid(row_sp_tmp[i], buf);
+
+#ifdef DEBUG
+    for (int i = 0; i < ROW; i++)
+    {
+        hybrid_row &r = row_sp_tmp[i];
+        cout << i << ": ";
+        if (is_dense(r))
+        {
+            for (int j = COL; j >= 0; j--)
+                if (r.bits[j / mat_L] & ((mat_t)1 << (j % mat_L)))
+                    cout << j << ' ';
+        }
+        else
+            for (int c : r.idx)
+                cout << c << ' ';
+        cout << endl;
+    }
+#endif
+}
+
+// 只读映射整个文件，失败返回NULL
+const char *map_file(const string &path, size_t &size)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return NULL;
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        return NULL;
+    }
+    size = st.st_size;
+    void *p = size ? mmap(NULL, size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0) : MAP_FAILED;
+    close(fd);
+    return p == MAP_FAILED ? NULL : (const char *)p;
+}
+
+// 在映射的文本上逐行解析非负整数，每行调用一次 fn(行号, 列号, 个数)
+template <typename F>
+void parse_lines(const string &path, int nLines, F fn)
+{
+    size_t size;
+    const char *c = map_file(path, size);
+    if (!c)
+    {
+        cout << "failed to open " << path << endl;
+        exit(-1);
+    }
+    const char *begin = c, *end = c + size;
+    vector<int> cols;
+    for (int line = 0; line < nLines && c < end; line++, c++)
+    {
+        cols.clear();
+        while (c < end && *c != '\n')
+        {
+            if (*c >= '0' && *c <= '9')
+            {
+                int v = 0;
+                while (c < end && *c >= '0' && *c <= '9')
+                    v = v * 10 + (*c++ - '0');
+                cols.push_back(v);
+            }
+            else
+                c++;
+        }
+        fn(line, cols.data(), (int)cols.size());
+    }
+    munmap((void *)begin, size);
+}
+
+#ifdef DENSE
+// 文本直接置位到稠密位图，每行首个数为消元子首项
+void load_text()
+{
+    parse_lines((string)DATA + (string) "1.txt", ELE, [](int, const int *cols, int cnt)
+                {
+                    if (!cnt)
+                        return;
+                    mat_t *e = ele[cols[0]];
+                    for (int t = 0; t < cnt; t++)
+                        e[cols[t] / mat_L] |= (mat_t)1 << (cols[t] % mat_L); });
+    parse_lines((string)DATA + (string) "2.txt", ROW, [](int i, const int *cols, int cnt)
+                {
+                    for (int t = 0; t < cnt; t++)
+                        row[i][cols[t] / mat_L] |= (mat_t)1 << (cols[t] % mat_L); });
+}
+
+// 二进制格式：头部之后依次为各消元子和 ROW 个被消元行，
+// 每条记录是 int 首项（-1 为零行）加上首项所在字及以下的 首项/mat_L+1 个字
+struct bin_header
+{
+    char magic[4];
+    int mat_bits, col, ele, row;
+};
+
+void save_binary(const char *path)
+{
+    FILE *f = fopen(path, "wb");
+    if (!f)
+    {
+        cout << "failed to open " << path << endl;
+        exit(-1);
+    }
+    static char buf[1 << 20];
+    setvbuf(f, buf, _IOFBF, sizeof(buf));
+    bin_header h = {{'G', 'R', 'B', 'N'}, mat_L, COL, 0, ROW};
+    for (int j = 0; j < COL; j++)
+        if (ele[j][j / mat_L] & ((mat_t)1 << (j % mat_L)))
+            h.ele++;
+    fwrite(&h, sizeof(h), 1, f);
+    for (int j = 0; j < COL; j++)
+        if (ele[j][j / mat_L] & ((mat_t)1 << (j % mat_L)))
+        {
+            fwrite(&j, sizeof(int), 1, f);
+            fwrite(ele[j], sizeof(mat_t), j / mat_L + 1, f);
+        }
+    for (int i = 0; i < ROW; i++)
+    {
+        int lead = row_lead(row[i], COL);
+        fwrite(&lead, sizeof(int), 1, f);
+        if (lead >= 0)
+            fwrite(row[i], sizeof(mat_t), lead / mat_L + 1, f);
+    }
+    fclose(f);
+}
+
+// 读取二进制位图，文件不存在、与编译参数不符或内容不完整时返回false（调用者改为解析文本）
+// 校验失败前可能已写入部分行，因此先清零再返回
+bool load_binary(const char *path)
+{
+    size_t size;
+    const char *p = map_file(path, size);
+    if (!p)
+        return false;
+    const char *c = p, *end = p + size;
+    bin_header h;
+    bool ok = size >= sizeof(h);
+    if (ok)
+    {
+        memcpy(&h, c, sizeof(h));
+        c += sizeof(h);
+        ok = !memcmp(h.magic, "GRBN", 4) && h.mat_bits == mat_L && h.col == COL && h.ele >= 0 && h.ele <= ELE && h.row == ROW;
+    }
+    for (int r = 0; ok && r < h.ele + ROW; r++)
+    {
+        int lead;
+        if ((size_t)(end - c) < sizeof(int))
+        {
+            ok = false;
+            break;
+        }
+        memcpy(&lead, c, sizeof(int));
+        c += sizeof(int);
+        if (lead < 0)
+            continue;
+        size_t words = sizeof(mat_t) * (lead / mat_L + 1);
+        if (lead >= COL || (size_t)(end - c) < words)
+        {
+            ok = false;
+            break;
+        }
+        mat_t *dst = r < h.ele ? ele[lead] : row[r - h.ele];
+        memcpy(dst, c, words);
+        c += words;
+    }
+    ok = ok && c == end;
+    munmap((void *)p, size);
+    if (!ok)
+    {
+        cerr << path << " does not match this build, parsing text instead" << endl;
+        memset(ele, 0, sizeof(ele));
+        memset(row, 0, sizeof(row));
+    }
+    return ok;
+}
+#endif
+
+inline void make_hybrid(hybrid_row &r, const int *cols, int cnt)
+{
+    r.bits.clear();
+    r.idx.assign(cols, cols + cnt);
+    sort(r.idx.begin(), r.idx.end(), greater<int>());
+    r.lead = r.idx.empty() ? -1 : r.idx[0];
+    if (cnt * DENSE_RATIO > COL / mat_L + 1)
+        densify(r);
+}
+
+// 直接读入混合表示，稠密的 ele/row 不会被触碰，也就不占物理内存
+void load_sparse(bool rows = true)
+{
+    parse_lines((string)DATA + (string) "1.txt", ELE, [](int, const int *cols, int cnt)
+                {
+                    if (cnt)
+                        make_hybrid(ele_sp[cols[0]], cols, cnt); });
+    if (rows)
+        parse_lines((string)DATA + (string) "2.txt", ROW, [](int i, const int *cols, int cnt)
+                    { make_hybrid(row_sp[i], cols, cnt); });
+}
+
+// 带缓冲的顺序读取，每次取出一行的列号，内存占用与文件大小无关
+struct line_reader
+{
+    FILE *f;
+    vector<char> buf;
+    size_t pos = 0, len = 0;
+
+    line_reader(const string &path) : f(fopen(path.c_str(), "rb")), buf(1 << 22)
+    {
+        if (!f)
+        {
+            cout << "failed to open " << path << endl;
+            exit(-1);
+        }
+    }
+    ~line_reader() { fclose(f); }
+
+    int get()
+    {
+        if (pos == len)
+        {
+            len = fread(buf.data(), 1, buf.size(), f);
+            pos = 0;
+            if (!len)
+                return EOF;
+        }
+        return buf[pos++];
+    }
+
+    // 文件结束时返回false
+    bool next(vector<int> &cols)
+    {
+        cols.clear();
+        int ch = get(), v = -1;
+        if (ch == EOF)
+            return false;
+        for (; ch != EOF && ch != '\n'; ch = get())
+        {
+            if (ch >= '0' && ch <= '9')
+                v = (v < 0 ? 0 : v * 10) + (ch - '0');
+            else if (v >= 0)
+            {
+                cols.push_back(v);
+                v = -1;
+            }
+        }
+        if (v >= 0)
+            cols.push_back(v);
+        return true;
+    }
+};
+
+void write_hybrid(FILE *out, const hybrid_row &r)
+{
+    if (is_dense(r))
+    {
+        for (int j = r.lead; j >= 0; j--)
+            if (r.bits[j / mat_L] & ((mat_t)1 << (j % mat_L)))
+                fprintf(out, "%d ", j);
+    }
+    else
+        for (int c : r.idx)
+            fprintf(out, "%d ", c);
+    fputc('\n', out);
+}
+
+// 流式消元：只有消元子（混合表示）常驻，被消元行每批 ROW_BATCH 行读入、消去、写出后即释放，
+// 行数不受 ROW 限制，读到文件结束为止；稠密参数不使用，只为符合 test 的函数类型
+void groebner_stream(mat_t[COL][COL / mat_L + 1], mat_t[ROW][COL / mat_L + 1])
+{
+    reset_ele_sp();
+    line_reader in((string)DATA + (string) "2.txt");
+    FILE *out = fopen(OUT_FILE, "w");
+    if (!out)
+    {
+        cout << "failed to open " << OUT_FILE << endl;
+        exit(-1);
+    }
+    static char out_buf[1 << 22];
+    setvbuf(out, out_buf, _IOFBF, sizeof(out_buf));
+
+    vector<hybrid_row> batch(ROW_BATCH);
+    vector<int> cols, buf;
+    int n;
+    do
+    {
+        for (n = 0; n < ROW_BATCH && in.next(cols); n++)
+            make_hybrid(batch[n], cols.data(), (int)cols.size());
+        for (int i = 0; i < n; i++)
+            reduce_hybrid(batch[i], buf);
+        for (int i = 0; i < n; i++)
+            write_hybrid(out, batch[i]);
+    } while (n == ROW_BATCH);
+    fclose(out);
+}
+
+int main(int argc, char *argv[])
+{
+    select_xor();
+    // ./groebner convert：解析文本后写出 BIN_FILE，之后的运行直接读二进制
+    bool convert = argc > 1 && !strcmp(argv[1], "convert");
+#ifdef DENSE
+    place_memory(ele, sizeof(ele)); // 在读入（首次访问）前设置内存策略
+    place_memory(row, sizeof(row));
+    place_memory(ele_buf, sizeof(ele_buf));
+    place_memory(row_buf, sizeof(row_buf));
+    if (convert || !load_binary(BIN_FILE))
+        load_text();
+    if (convert)
+    {
+        save_binary(BIN_FILE);
+        return 0;
+    }
+#else
+    if (convert)
+    {
+        cout << "convert needs the dense build (without -DSPARSE/-DSTREAM)" << endl;
+        return -1;
+    }
+#endif
+#if defined(SPARSE) || (defined(STREAM) && defined(DEBUG))
+    load_sparse();
+#elif defined(STREAM)
+    load_sparse(false);
+#endif
 
 #ifdef DEBUG
     groebner(ele, row);
@@ -334,16 +1376,60 @@ int main()
     cout << endl
          << "end" << endl;
     groebner_pthread(ele, row);
+    cout << endl
+         << "end" << endl;
+    groebner_m4r(ele, row);
+    cout << endl
+         << "end" << endl;
+    groebner_m4r_pthread(ele, row);
+    cout << endl
+         << "end" << endl;
+    groebner_lockfree(ele, row);
+#ifdef _OPENMP
+    cout << endl
+         << "end" << endl;
+    groebner_omp(ele, row);
+#endif
+#ifdef PSTL
+    cout << endl
+         << "end" << endl;
+    groebner_pstl(ele, row);
+#endif
+#if defined(SPARSE) || defined(STREAM)
+    cout << endl
+         << "end" << endl;
+    groebner_sparse(ele, row);
+#endif
+#ifdef STREAM
+    groebner_stream(ele, row);
+#endif
 #else
-    if (NUM_THREADS == 1)
+#ifdef STREAM
+    test(groebner_stream, "stream");
+#elif defined(SPARSE)
+    test(groebner_sparse, "sparse");
+#elif defined(LOCKFREE)
+    test(groebner_lockfree, "lock-free");
+#elif defined(M4R)
+    if (nthreads == 1)
+        test(groebner_m4r, "m4r");
+    else
+        test(groebner_m4r_pthread, "m4r pthread");
+#else
+#ifndef IN_PLACE // 原地消元会覆盖输入，不能重复测试
+    if (getenv("SCALE_THREADS"))
+    {
+        scale_backends(getenv("BACKEND") ? getenv("BACKEND") : "pthread");
+        return 0;
+    }
+#endif
+    if (getenv("BACKEND"))
+        test_backends(getenv("BACKEND"));
+    else if (nthreads == 1)
         test(groebner, "common");
     else
         test(groebner_pthread, "pthread");
-#ifdef __amd64__
-        // test(groebner_avx, "avx");
-#endif
-#ifdef __AVX512F__
-    test(groebner_avx512, "avx512");
+    report_placement(row_tmp, sizeof(row_buf), nthreads);
 #endif
 #endif
     return 0;
@@ -1,7 +1,9 @@
 # !/bin/sh
 timestr=$(date +%m_%d_%H_%M)
+# 每个测试点预热1次、计时5次取中位数（见 bench.h）
+export BENCH_WARMUP=1 BENCH_REPT=5
 data_path="../Groebner/"
-num_th=("1" "4" "8" "12" "16" "20")
+num_th="1,4,8,12,16,20"
 
 for file in $(ls ${data_path}); do
     if [ "$file" == "README.txt" ]; then
@@ -9,18 +11,23 @@ for file in $(ls ${data_path}); do
     else
         attr=(${file//_/ })
         # echo ${arrIN[1]}
-        if [ "${attr[0]}" == "8" ]; then
-            break
-        fi
-        echo "${data_path}${file}/"
-        for j in {0..5}; do
-            echo ${num_th[j]}"threads"
-            g++ -march=native -w -pthread -DDATA=\"${data_path}${file}/\" \
+        if [ "${attr[0]}" -ge "8" ]; then
+            # 大数据集稠密存储放不下，使用稀疏混合表示（串行）
+            echo "${data_path}${file}/ sparse"
+            g++ -O3 -march=native -w -pthread -DSPARSE -DDATA=\"${data_path}${file}/\" \
                 -DCOL=${attr[1]} -DELE=${attr[2]} -DROW=${attr[3]} \
-                -DNUM_THREADS=$((${num_th[j]})) \
                 ./groebner.cpp -o ./groebner
             ./groebner >>groebner_$timestr.csv
-        done
+            echo '' >>groebner_$timestr.csv
+            continue
+        fi
+        echo "${data_path}${file}/"
+        # 每个数据集只编译一次（-O3），线程数由程序在同一进程中扫描（见 scaling.h）
+        g++ -O3 -march=native -w -pthread -DDATA=\"${data_path}${file}/\" \
+            -DCOL=${attr[1]} -DELE=${attr[2]} -DROW=${attr[3]} \
+            -DNUM_THREADS=20 \
+            ./groebner.cpp -o ./groebner
+        SCALE_THREADS=$num_th SCALE_OUT=groebner_scaling_$timestr.csv ./groebner >>groebner_$timestr.csv
         echo '' >>groebner_$timestr.csv
     fi
 done
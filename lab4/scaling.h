@@ -0,0 +1,111 @@
+// 扩展性扫描，gauss.cpp 和 groebner.cpp 共用，取代每个 (规模, 线程数) 重新编译一次的脚本
+// 设置环境变量 SCALE_THREADS 后进入扫描模式，在同一进程中依次测试：
+//   SCALE_THREADS=1,2,4,8   线程数列表，超过编译时 NUM_THREADS 的忽略，没有1时自动补上作为基准
+//   SCALE_N=512,1024,2048   规模列表（gauss，不超过编译时的 N）；groebner 的规模由数据集决定
+//   SCALE_OUT=scaling.csv   结果追加到该文件（默认 scaling.csv），文件为空时先写表头
+// 每个测试点一行（tidy 格式），lab2/datav/time.py 直接读取：
+//   program,kernel,mode,base_n,n,threads,median,stddev,speedup,efficiency,karp_flatt
+// T(n,1) 是同一个内核以1个线程运行的时间（不是另一个串行算法），加速比只反映该内核自身的扩展性
+// strong：规模不变，S = T(n,1)/T(n,p)，E = S/p，Karp-Flatt 实验串行比例 e = (1/S - 1/p)/(1 - 1/p)
+// weak：  每线程工作量不变，工作量 ~ n^order 时 n_p = n*p^(1/order)，E = T(n,1)/T(n_p,p)，S = p*E
+// base_n 为弱扩展序列的1线程规模（strong 时等于 n）；karp_flatt 只对 strong 且 p>1 的行有定义，其余留空
+// 每个点的时间为 bench 重复 BENCH_REPT 次的中位数，标准输出同时打印 kernel,n,threads,时间,
+#ifndef SCALING_H
+#define SCALING_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+#include "bench.h"
+
+// 解析逗号分隔的整数列表，未设置时返回 dflt
+inline std::vector<int> scale_list(const char *name, std::vector<int> dflt)
+{
+    const char *v = getenv(name);
+    if (!v)
+        return dflt;
+    std::vector<int> list;
+    for (const char *p = v; *p;)
+    {
+        char *end;
+        long x = strtol(p, &end, 10);
+        if (end == p)
+            break;
+        if (x > 0)
+            list.push_back(x);
+        p = *end == ',' ? end + 1 : end;
+    }
+    return list;
+}
+
+inline void scale_row(FILE *f, const char *program, const char *kernel, const char *mode, int base_n, int n, int p,
+                      const bench_result &r, double speedup, double efficiency)
+{
+    fprintf(f, "%s,%s,%s,%d,%d,%d,%.9g,%.9g,%.6g,%.6g,", program, kernel, mode, base_n, n, p, r.median, r.stddev, speedup, efficiency);
+    if (p > 1 && !strcmp(mode, "strong"))
+        fprintf(f, "%.6g", (1 / speedup - 1.0 / p) / (1 - 1.0 / p));
+    fprintf(f, "\n");
+    fflush(f);
+}
+
+// run(n, p) 以 p 个线程测试规模 n，返回 bench 的结果；order <= 0 时不做弱扩展（规模不能改变）
+template <typename F>
+void scale_sweep(const char *program, const char *kernel, const std::vector<int> &sizes, int max_n,
+                 double order, int max_threads, F run)
+{
+    std::vector<int> threads;
+    for (int p : scale_list("SCALE_THREADS", {1}))
+        if (p <= max_threads)
+            threads.push_back(p);
+        else
+            fprintf(stderr, "scaling: %d threads exceeds NUM_THREADS=%d, skipped\n", p, max_threads);
+    threads.push_back(1);
+    std::sort(threads.begin(), threads.end());
+    threads.erase(std::unique(threads.begin(), threads.end()), threads.end());
+
+    const char *path = getenv("SCALE_OUT") ? getenv("SCALE_OUT") : "scaling.csv";
+    FILE *f = fopen(path, "a");
+    if (!f)
+    {
+        perror(path);
+        return;
+    }
+    fseek(f, 0, SEEK_END);
+    if (ftell(f) == 0)
+        fprintf(f, "program,kernel,mode,base_n,n,threads,median,stddev,speedup,efficiency,karp_flatt\n");
+
+    for (int n : sizes)
+    {
+        if (n > max_n)
+        {
+            fprintf(stderr, "scaling: n=%d exceeds N=%d, skipped\n", n, max_n);
+            continue;
+        }
+        bench_result base = run(n, 1);
+        for (int p : threads)
+        {
+            bench_result r = p == 1 ? base : run(n, p);
+            double s = base.median / r.median;
+            scale_row(f, program, kernel, "strong", n, n, p, r, s, s / p);
+            printf("%s,%d,%d,%g,\n", kernel, n, p, r.median);
+        }
+        if (order <= 0)
+            continue;
+        for (int p : threads)
+        {
+            int np = (int)lround(n * pow(p, 1 / order));
+            if (np > max_n)
+                break;
+            bench_result r = p == 1 ? base : run(np, p);
+            double e = base.median / r.median;
+            scale_row(f, program, kernel, "weak", n, np, p, r, p * e, e);
+            printf("%s,%d,%d,%g,\n", kernel, np, p, r.median);
+        }
+    }
+    fclose(f);
+}
+
+#endif
@@ -1,24 +1,20 @@
 # !/bin/sh
+# 只编译一次（-O3），由程序在同一进程中扫描规模和线程数（见 scaling.h），
+# 结果为 tidy CSV（强/弱扩展效率、Karp-Flatt），用 lab2/datav/time.py 画图
 timestr=$(date +%m_%d_%H_%M)
-lastfinish=$(date +%m_%d_%H_%M_%S)
-num_th=("1" "4" "8" "12" "16" "20")
+# 每个测试点预热1次、计时5次取中位数（见 bench.h）
+export BENCH_WARMUP=1 BENCH_REPT=5
+num_th="1,4,8,12,16,20"
+sizes=$(seq -s, 128 128 4096)
 
-pssh -h $PBS_NODEFILE mkdir -p /home/s2010056/4_pthread 1>&2
+pssh -h $PBS_NODEFILE mkdir -p /home/s2010056/4_pthread /home/s2010056/common 1>&2
 pscp -h $PBS_NODEFILE /home/s2010056/NKU_parallel_programming/4_pthread/gauss.cpp /home/s2010056/4_pthread 1>&2
+pscp -h $PBS_NODEFILE /home/s2010056/NKU_parallel_programming/4_pthread/*.h /home/s2010056/4_pthread 1>&2
+pscp -h $PBS_NODEFILE /home/s2010056/NKU_parallel_programming/common/perf.h /home/s2010056/common 1>&2 # bench.h 以 ../common/perf.h 包含
 pscp -h $PBS_NODEFILE /home/s2010056/NKU_parallel_programming/4_pthread/gauss.dat /home/s2010056/4_pthread 1>&2
 
-
-for i in {1..32}; do
-    echo -n $((128 * i))"," >>/home/s2010056/4_pthread/gauss_timing_$timestr.csv
-    for j in {0..5}; do
-        g++ -O0 -march=native -w -pthread -DNUM_THREADS=$((${num_th[j]})) -DN=$((128 * i)) /home/s2010056/4_pthread/gauss.cpp -o /home/s2010056/4_pthread/gauss_test
-        echo "$(${num_th[i]}) threads"
-        echo "now calculating: "$((128 * i))
-        echo "time start: "$timestr
-        echo "last finish: "$lastfinish
-        echo "time now: "$(date +%m_%d_%H_%M_%S)
-        /home/s2010056/4_pthread/gauss_test >>/home/s2010056/4_pthread/gauss_timing_$timestr.csv
-        lastfinish=$(date +%m_%d_%H_%M_%S)
-    done
-    echo "">>/home/s2010056/4_pthread/gauss_timing_$timestr.csv
-done
+g++ -O3 -march=native -w -pthread -DNUM_THREADS=20 -DN=4096 /home/s2010056/4_pthread/gauss.cpp -o /home/s2010056/4_pthread/gauss_test
+echo "time start: "$timestr
+cd /home/s2010056/4_pthread
+SCALE_THREADS=$num_th SCALE_N=$sizes SCALE_OUT=/home/s2010056/4_pthread/gauss_scaling_$timestr.csv /home/s2010056/4_pthread/gauss_test
+echo "time now: "$(date +%m_%d_%H_%M_%S)
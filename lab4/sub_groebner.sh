@@ -1,8 +1,12 @@
 timestr=$(date +%m_%d_%H_%M)
-pssh -h $PBS_NODEFILE mkdir -p /home/s2010056/4_pthread 1>&2
+# 每个测试点预热1次、计时5次取中位数（见 bench.h）
+export BENCH_WARMUP=1 BENCH_REPT=5
+pssh -h $PBS_NODEFILE mkdir -p /home/s2010056/4_pthread /home/s2010056/common 1>&2
 pscp -h $PBS_NODEFILE /home/s2010056/NKU_parallel_programming/4_pthread/groebner.cpp /home/s2010056/4_pthread 1>&2
+pscp -h $PBS_NODEFILE /home/s2010056/NKU_parallel_programming/4_pthread/*.h /home/s2010056/4_pthread 1>&2
+pscp -h $PBS_NODEFILE /home/s2010056/NKU_parallel_programming/common/perf.h /home/s2010056/common 1>&2 # bench.h 以 ../common/perf.h 包含
 data_path="/home/data/Groebner/"
-num_th=("1" "4" "8" "12" "16" "20")
+num_th="1,4,8,12,16,20"
 
 for file in $(ls ${data_path}); do
     if [ "$file" == "README.txt" ]; then
@@ -10,17 +14,23 @@ for file in $(ls ${data_path}); do
     else
         attr=(${file//_/ })
         # echo ${arrIN[1]}
-        if [ "${attr[0]}" -gt "8" ]; then
+        if [ "${attr[0]}" -ge "8" ]; then
+            # 大数据集稠密存储放不下，使用稀疏混合表示（串行）
+            echo "${data_path}${file}/ sparse"
+            g++ -O3 -march=native -w -pthread -DSPARSE -DDATA=\"${data_path}${file}/\" \
+                -DCOL=${attr[1]} -DELE=${attr[2]} -DROW=${attr[3]} \
+                /home/s2010056/4_pthread/groebner.cpp -o /home/s2010056/4_pthread/groebner
+            /home/s2010056/4_pthread/groebner >>/home/s2010056/4_pthread/groebner_$timestr.csv
+            echo '' >>/home/s2010056/4_pthread/groebner_$timestr.csv
             continue
         fi
         echo "${data_path}${file}/"
-        for j in {0..5}; do
-            echo ${num_th[j]}"threads"
-            g++ -march=native -w -pthread -DDATA=\"${data_path}${file}/\" \
-                -DCOL=${attr[1]} -DELE=${attr[2]} -DROW=${attr[3]} -DNUM_THREADS=$((${num_th[j]})) \
-                /home/s2010056/4_pthread/groebner.cpp -o /home/s2010056/4_pthread/groebner
+        # 每个数据集只编译一次（-O3），线程数由程序在同一进程中扫描（见 scaling.h）
+        g++ -O3 -march=native -w -pthread -DDATA=\"${data_path}${file}/\" \
+            -DCOL=${attr[1]} -DELE=${attr[2]} -DROW=${attr[3]} -DNUM_THREADS=20 \
+            /home/s2010056/4_pthread/groebner.cpp -o /home/s2010056/4_pthread/groebner
+        SCALE_THREADS=$num_th SCALE_OUT=/home/s2010056/4_pthread/groebner_scaling_$timestr.csv \
             /home/s2010056/4_pthread/groebner >>/home/s2010056/4_pthread/groebner_$timestr.csv
-        done
         echo '' >>/home/s2010056/4_pthread/groebner_$timestr.csv
     fi
 done